@@ -1,6 +1,8 @@
 #pragma once
 
-#include <list>
+#include "common/type.hpp"
+
+#include <vector>
 #include <string>
 #include <type_traits>
 #include <cstdint>
@@ -22,13 +24,21 @@
  * 8 bits is plenty enough for Night.
  * 
  * **Design Decision #2**
- * bytecodes_t is a forward list and not a vector.
+ * bytecodes_t is a vector and not a list.
+ * 
+ * Bytecodes are generated once but interpreted many times, so the container is
+ * chosen for the interpreter and not for the code generator. A vector stores
+ * its bytecodes in one contiguous block, so walking it is cache friendly and
+ * moving the instruction pointer by an offset is constant time. A list would
+ * allocate a separate node with two pointers for every single byte.
  * 
- * The main operations are appending/inserting other bytecode containers, and
- * list has a better time complexity for that operation than vector.
+ * The code generator mostly appends bytecode containers, which is amortized
+ * constant time for vectors. The only insertions in the middle of a container
+ * are the jump values of conditionals and loops, which are done once per
+ * statement at compile time.
  */
 using bytecode_t = uint8_t;
-using bytecodes_t = std::list<bytecode_t>;
+using bytecodes_t = std::vector<bytecode_t>;
 
 /**
  * @brief Enumeration of all bytecode types in Night
@@ -105,35 +115,57 @@ enum : bytecode_t {
 	
 	ByteType_EQ_I, ByteType_EQ_F, ByteType_EQ_S,
 	ByteType_NE_I, ByteType_NE_F, ByteType_NE_S,
-	
-	BytecodeType_AND,	// numeric, numeric, AND
-	BytecodeType_OR,	// numeric, numeric, OR
 
 	BytecodeType_INDEX_S,	// numeric(string), INDEX_S
+	BytecodeType_INDEX_S_UNCHECKED,	// INDEX_S whose index is known to be in bounds
 	BytecodeType_INDEX_A,	// numeric(array), INDEX_A
+	BytecodeType_INDEX_A_REF,	// numeric(array), INDEX_A_REF
+
+	// Elements of arrays stored unboxed, see arr_elem_size()
+	BytecodeType_INDEX_A_I8, BytecodeType_INDEX_A_U8,		// numeric, array, INDEX_A_*
+	BytecodeType_INDEX_A_I16, BytecodeType_INDEX_A_U16,
+	BytecodeType_INDEX_A_I32, BytecodeType_INDEX_A_U32,
 
-	ByteType_LOAD,
-	BytecodeType_LOAD_ELEM,
+	BytecodeType_LOAD_LOCAL,	// LOAD_LOCAL id
+	BytecodeType_LOAD_GLOBAL,	// LOAD_GLOBAL id
+	BytecodeType_LOAD_CONST,	// LOAD_CONST id
 
 	ByteType_DUP,
+	ByteType_DUP2,
+	BytecodeType_DEREF,			// reference, DEREF
+	BytecodeType_POP,			// value, POP
 	
-	ByteType_STORE,
+	BytecodeType_STORE_LOCAL,	// numeric, STORE_LOCAL id
+	BytecodeType_STORE_GLOBAL,	// numeric, STORE_GLOBAL id
 	ByteType_STORE_INPLACE,
-	BytecodeType_STORE_INDEX_A,
-	BytecodeType_STORE_INDEX_S,
+
+	BytecodeType_STORE_INDEX_A_8,	// numeric, array, numeric, STORE_INDEX_A_*
+	BytecodeType_STORE_INDEX_A_16,
+	BytecodeType_STORE_INDEX_A_32,
 	
 	BytecodeType_ALLOCATE_STR,
-	BytecodeType_ALLOCATE_ARR,
-	BytecodeType_ALLOCATE_ARR_AND_FILL,
-	BytecodeType_FREE_STR,
-	BytecodeType_FREE_ARR,
+	BytecodeType_ALLOCATE_ARR,			// elements, element size, ALLOCATE_ARR
+	BytecodeType_ALLOCATE_ARR_AND_FILL,	// sizes, element size, ALLOCATE_ARR_AND_FILL
 
-	BytecodeType_JUMP,
-	ByteType_JUMP_N,
-	BytecodeType_JUMP_IF_FALSE,
+	BytecodeType_JUMP,			// JUMP offset
+	BytecodeType_JUMP_IF_FALSE,	// numeric, JUMP_IF_FALSE offset
 
 	BytecodeType_RETURN,
-	BytecodeType_CALL
+	BytecodeType_CALL,
+	BytecodeType_TAIL_CALL,
+
+	// Superinstructions are never generated. They are fused from common
+	// sequences of bytecodes when decoding, see intpr::decode()
+	BytecodeType_ADD_CONST_I,	// numeric, ADD_CONST_I value
+	BytecodeType_INC_LOCAL,		// INC_LOCAL id value
+	BytecodeType_INC_GLOBAL,	// INC_GLOBAL id value
+
+	BytecodeType_LT_I_JUMP_IF_FALSE,	// numeric, numeric, LT_I_JUMP_IF_FALSE offset
+	BytecodeType_LE_I_JUMP_IF_FALSE,
+	BytecodeType_GT_I_JUMP_IF_FALSE,
+	BytecodeType_GE_I_JUMP_IF_FALSE,
+	BytecodeType_EQ_I_JUMP_IF_FALSE,
+	BytecodeType_NE_I_JUMP_IF_FALSE
 };
 
 template <typename T>
@@ -148,6 +180,7 @@ requires std::is_same<T, int8_t>::value ||
 bytecodes_t int_to_bytes(T i)
 {
 	bytecodes_t bytes;
+	bytes.reserve(1 + sizeof(T));
 	
 	if (std::is_same<T, int8_t>::value)
 		bytes.push_back(ByteType_sINT1);
@@ -175,11 +208,118 @@ bytecodes_t int_to_bytes(T i)
 	return bytes;
 }
 
+/**
+ * @brief Offset stored inline after a jump bytecode type.
+ * 
+ * Unlike integer values, jump offsets are not pushed onto the Interpreter's
+ * stack. They are stored directly after JUMP and JUMP_IF_FALSE as a fixed
+ * width operand, so the size of every jump is known before its offset is.
+ * 
+ * While generating bytecodes, the offset is relative to the end of the jump,
+ * so bytecode containers can be concatenated freely. Once a bytecode container
+ * is complete, link_jumps() turns every offset into an absolute offset from
+ * the start of the container, so a jump is a single assignment.
+ */
+using jump_offset_t = int32_t;
+
+/**
+ * @brief Variable id stored inline after a LOAD or STORE bytecode type.
+ * 
+ * Like jump offsets, variable ids are never pushed onto the Interpreter's
+ * stack, so accessing a variable is a single bytecode. A variable's id is the
+ * index of its slot in its frame.
+ * 
+ * Local variables are variables of the function currently being interpreted,
+ * and global variables are variables of the global scope, which can be
+ * accessed directly without searching through the scopes in between.
+ */
+using variable_id_t = uint64_t;
+
+/*
+ * Constant id stored inline after LOAD_CONST. Numeric and string literals are
+ * added to a constant pool shared by the whole program when generating
+ * bytecodes, and the id is the index of the constant in the pool.
+ */
+using const_id_t = uint32_t;
+
 namespace night {
 
+/**
+ * @brief Size of a jump bytecode type and its offset.
+ */
+constexpr std::size_t jump_size = sizeof(bytecode_t) + sizeof(jump_offset_t);
+
+/**
+ * @brief Size of a LOAD or STORE bytecode type and its variable id.
+ */
+constexpr std::size_t variable_size = sizeof(bytecode_t) + sizeof(variable_id_t);
+
 /**
  * @brief Bytecode type to string. Used in error messages and debugging.
  */
 std::string to_str(bytecode_t type);
 
+/**
+ * @brief Number of codes stored inline after the bytecode type.
+ */
+std::size_t operand_size(bytecode_t type);
+
+/**
+ * @brief Creates a jump with a relative offset.
+ * 
+ * @param jump_type Either JUMP or JUMP_IF_FALSE.
+ * @param offset Relative to the end of the jump. Can be set later with
+ *   set_jump_offset() if it is not known yet.
+ */
+bytecodes_t jump_to_bytes(bytecode_t jump_type, jump_offset_t offset = 0);
+
+/**
+ * @brief Creates a LOAD or STORE of a variable.
+ * 
+ * @param variable_type One of LOAD_LOCAL, LOAD_GLOBAL, STORE_LOCAL or
+ *   STORE_GLOBAL.
+ */
+bytecodes_t variable_to_bytes(bytecode_t variable_type, variable_id_t id);
+
+/**
+ * @brief Creates a LOAD_CONST of a constant in the constant pool.
+ */
+bytecodes_t const_to_bytes(const_id_t id);
+
+/**
+ * @brief Size in bytes of the elements of an array of the type.
+ * 
+ * One dimensional arrays of booleans and of integers smaller than 64 bits
+ * store their elements unboxed in their own size, and are indexed with the
+ * INDEX_A_* and STORE_INDEX_A_* of that size. All other arrays store values.
+ * 
+ * Unlike variables of the same type, which hold any 64 bit value, elements
+ * stored unboxed are truncated to their size, so values outside of the range
+ * of the type wrap around.
+ */
+std::size_t arr_elem_size(Type const& arr_type);
+
+/**
+ * @brief Bytecode type that loads an element of an array of the type.
+ */
+bytecode_t index_arr_type(Type const& arr_type);
+
+/**
+ * @param index Index of the jump bytecode type in codes.
+ */
+jump_offset_t get_jump_offset(bytecodes_t const& codes, std::size_t index);
+
+/**
+ * @param index Index of the jump bytecode type in codes.
+ */
+void set_jump_offset(bytecodes_t& codes, std::size_t index, jump_offset_t offset);
+
+/**
+ * @brief Turns the relative offsets of all jumps into absolute offsets.
+ * 
+ * Must be called exactly once on a complete bytecode container, that is the
+ * global codes and the codes of each function.
+ */
+void link_jumps(bytecodes_t& codes);
+
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+/*
+ * Formatting of numbers for print() and str(), which is a hot path for
+ * programs that print a lot of numbers. Unlike snprintf(), the formatters do
+ * not parse a format string, and they produce exactly the same characters as
+ * the printf() formats used by Night.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace intpr
+{
+
+// Maximum number of characters of a formatted integer.
+constexpr std::size_t max_int_length = 20;
+
+// Maximum number of characters of a float formatted by format_float().
+constexpr std::size_t max_float_length = 32;
+
+// Maximum number of characters of a float formatted by format_fixed().
+constexpr std::size_t max_fixed_length = 48;
+
+/*
+ * Each of the formatters writes a number into buf, without a null terminator,
+ * and returns the number of characters written. buf must have room for the
+ * maximum length of the format.
+ */
+
+// Formats an integer like "%" PRId64.
+std::size_t format_int(char* buf, int64_t i);
+
+// Formats an unsigned integer like "%" PRIu64.
+std::size_t format_uint(char* buf, uint64_t ui);
+
+// Formats a float like "%.17g", which round trips every double.
+std::size_t format_float(char* buf, double d);
+
+// Formats a float like "%f".
+std::size_t format_fixed(char* buf, float f);
+
+} // intpr::
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "interpreter_scope.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace intpr
+{
+
+/*
+ * Strings and arrays created by the Interpreter, freed by a mark and sweep
+ * garbage collector.
+ *
+ * Values carry no type information, so the collector is conservative. Any
+ * value on the Interpreter's stack or in the global frame that holds an
+ * address inside a heap object keeps that object alive, and so does any
+ * element of a live array. Integers that happen to look like an address can
+ * only keep garbage alive longer, never free a live object.
+ */
+class Heap
+{
+public:
+	/*
+	 * Allocates a string of the given length, excluding the null terminator,
+	 * which is already set.
+	 *
+	 * Strings of up to small_str_length characters all use blocks of the same
+	 * size, which are reused once collected instead of being freed.
+	 */
+	static char* allocate_str(std::size_t length);
+
+	static constexpr std::size_t small_str_length = 15;
+
+	/*
+	 * Concatenates two strings. Concatenations longer than min_concat_length
+	 * are created as a Concat, so appending to a long string in a loop does not
+	 * copy it every time.
+	 */
+	static char* concat(char* left, char* right);
+
+	static constexpr std::size_t min_concat_length = 64;
+
+	/*
+	 * Copies a Concat into a single string, which is kept in the Concat so it
+	 * is only copied once.
+	 */
+	static char* flatten(char* s);
+
+	/*
+	 * Allocates an array of the given size, with its elements set to zero.
+	 *
+	 * Elements smaller than a value are stored unboxed, see arr_elem_size().
+	 */
+	static Array* allocate_arr(std::size_t size, std::size_t elem_size = sizeof(Value));
+
+	/*
+	 * Allocates a rectangular multi-dimensional array, with its elements set to
+	 * zero, as a single block.
+	 *
+	 * The arrays of every dimension are still arrays of arrays, so a row can
+	 * be used and assigned like any other array, but they are all stored in
+	 * the block, followed by the elements in row-major order.
+	 */
+	static Array* allocate_arr(std::vector<std::size_t> const& dimensions, std::size_t elem_size = sizeof(Value));
+
+	/*
+	 * Collects garbage once the heap has doubled since the last collection.
+	 *
+	 * Every object in use must be reachable from the given stack or the global
+	 * frame, so this is only called between instructions.
+	 */
+	static void collect_if_needed(Value const* stack_begin, Value const* stack_top)
+	{
+		if (bytes_allocated >= next_collection)
+			collect(stack_begin, stack_top);
+	}
+
+	static void collect(Value const* stack_begin, Value const* stack_top);
+
+	// Number of bytes allocated for heap objects, including garbage that has
+	// not been collected yet.
+	static std::size_t size() { return bytes_allocated; }
+
+private:
+	enum class ObjectType
+	{
+		STR,
+		ARR,
+		CONCAT,
+
+		// Array of elements stored unboxed, which hold no values to mark.
+		UNBOXED_ARR
+	};
+
+	struct Object
+	{
+		uintptr_t address;
+		std::size_t size;
+		ObjectType type;
+		bool is_marked;
+	};
+
+	// Values inside a live object that still have to be marked.
+	struct Values
+	{
+		Value const* data;
+		std::size_t size;
+	};
+
+	static void* allocate(std::size_t size, ObjectType type);
+
+	static constexpr std::size_t small_str_size = sizeof(String) + small_str_length + 1;
+
+	static void mark(Value const& value, std::vector<Values>& unmarked);
+
+	// Heap objects, in order of allocation. They are sorted by address when
+	// collecting, so a value pointing inside an object, such as a reference to
+	// an array element, can find it.
+	static std::vector<Object> objects;
+
+	// Collected blocks of small strings, ready to be reused.
+	static std::vector<void*> small_str_blocks;
+
+	static std::size_t bytes_allocated;
+	static std::size_t next_collection;
+};
+
+/*
+ * Returns the characters of a string, flattening it if it is a Concat.
+ */
+inline char* str_data(char* s)
+{
+	return ((String const*)s - 1)->is_concat ? Heap::flatten(s) : s;
+}
+
+} // intpr::
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+namespace intpr
+{
+
+/*
+ * Input read by the Interpreter from stdin.
+ *
+ * stdin is read in large blocks into a buffer owned by the Interpreter, and
+ * lines are found in it with memchr(), so reading a line does not cost a call
+ * per character.
+ */
+class Input
+{
+public:
+	/*
+	 * Reads the next line, without its newline, into a new string. Returns an
+	 * empty string once all input has been read.
+	 */
+	static char* read_line();
+
+	static constexpr std::size_t capacity = 1 << 16;
+
+private:
+	// Reads the next block of stdin into the buffer. Returns false if there
+	// is no more input.
+	static bool fill();
+
+	static char buffer[capacity];
+
+	// Characters of the buffer not read yet.
+	static std::size_t begin;
+	static std::size_t end;
+};
+
+} // intpr::
@@ -0,0 +1,89 @@
+/*
+ * The code generator emits bytecodes as a stream of bytes, where values such as
+ * integer literals are split into single byte codes following their bytecode
+ * type. Reassembling those values byte by byte every time they are interpreted
+ * is slow, so before interpreting, the bytecodes are decoded once into
+ * instructions that store their value as a native width operand.
+ */
+
+#pragma once
+
+#include "common/bytecode.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace intpr
+{
+
+/*
+ * A decoded bytecode.
+ * 
+ * Decoded instructions only use the following bytecode types with operands,
+ *   sINT8, uINT8			integer value, for integers of all sizes
+ *   FLT8					float value, for floats of both sizes
+ *   LOAD_LOCAL, LOAD_GLOBAL,
+ *   STORE_LOCAL, STORE_GLOBAL	variable id
+ *   LOAD_CONST				value of the constant
+ *   CALL, TAIL_CALL		function id
+ *   ALLOCATE_STR,
+ *   ALLOCATE_ARR			number of elements
+ *   ALLOCATE_ARR_AND_FILL	number of dimensions
+ *   JUMP, JUMP_IF_FALSE	index of the instruction to jump to
+ * 
+ * and the following superinstructions,
+ *   ADD_CONST_I			value of the constant
+ *   INC_LOCAL, INC_GLOBAL	value of the constant, and the variable id in id
+ *   *_I_JUMP_IF_FALSE		index of the instruction to jump to
+ * 
+ * All other bytecode types have no operand and are left unchanged.
+ */
+struct Instruction
+{
+	bytecode_t type;
+
+	// Second operand of superinstructions, stored in what would otherwise be
+	// padding before the operand.
+	uint32_t id;
+
+	union {
+		int64_t i;
+		uint64_t ui;
+		double d;
+	} operand;
+};
+
+using instructions_t = std::vector<Instruction>;
+
+/*
+ * Decodes bytecodes into instructions.
+ * 
+ * The function id pushed before CALL and TAIL_CALL, and the size pushed before
+ * ALLOCATE_*,
+ * is folded into the operand of the instruction, so it is never pushed onto
+ * the Interpreter's stack.
+ * 
+ * The most frequently interpreted sequences of bytecodes are then fused into
+ * a single superinstruction, so they are dispatched once,
+ *   LOAD_CONST, ADD_I or SUB_I					ADD_CONST_I
+ *   LOAD x, LOAD_CONST, ADD_I or SUB_I, STORE x	INC_LOCAL or INC_GLOBAL
+ *   LT_I, LE_I, GT_I, GE_I, EQ_I or NE_I,
+ *   JUMP_IF_FALSE								*_I_JUMP_IF_FALSE
+ * These were chosen by counting the pairs and triples of bytecodes
+ * interpreted by the programs in the tests and samples. A sequence is only
+ * fused when no jump targets the middle of it.
+ * 
+ * @param codes Complete bytecodes whose jumps are already linked.
+ */
+instructions_t decode(bytecodes_t const& codes);
+
+/*
+ * Returns the maximum number of values on the Interpreter's stack while
+ * interpreting the instructions, not including the stacks of function calls.
+ * 
+ * Every path to an instruction must leave the stack with the same number of
+ * values, which holds for all generated bytecodes.
+ */
+std::size_t max_stack_size(instructions_t const& instructions);
+
+} // intpr::
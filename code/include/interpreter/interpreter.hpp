@@ -1,11 +1,12 @@
 #pragma once
 
 #include "interpreter_scope.hpp"
+#include "instruction.hpp"
+#include "output.hpp"
 #include "common/bytecode.hpp"
 #include "common/debug.hpp"
 
 #include <math.h>
-#include <stack>
 #include <functional>
 #include <optional>
 #include <bitset>
@@ -14,51 +15,70 @@
 #include <stdlib.h>
 #include <string.h>
 
-std::optional<intpr::Value> interpret_bytecodes(
-	InterpreterScope& scope,
-	bytecodes_t const& codes,
-	bool is_global,
-	char* buf = NULL
-);
+namespace intpr
+{
 
-// template can either be int64_t or uint64_t
-// iterator
-//   start: int code type
-//   end: last code of int
-template <typename T>
-T interpret_int(bytecodes_t::const_iterator& it, unsigned short size)
+/*
+ * Number of values the Interpreter's stack can hold. The stack is shared by
+ * all function calls, and running out of it is a runtime error.
+ */
+constexpr std::size_t stack_capacity = 1 << 18;
+
+/*
+ * The state of a caller, restored once the function it called returns.
+ */
+struct CallFrame
 {
-	T num = 0;
-	for (unsigned short i = 0; i < size; ++i)
-	{
-		T byte = *(++it);
-		for (unsigned short j = 0; j < i; ++j)
-			byte <<= 8;
+	// The caller's CALL instruction.
+	Instruction const* return_ip;
 
-		num |= byte;
-	}
+	// The caller's instructions.
+	Instruction const* begin;
+	Instruction const* end;
 
-	return num;
-}
+	// The caller's variables and the start of its values on the stack.
+	Value* bp;
+	Value* base;
+};
 
-double interpret_flt(bytecodes_t::const_iterator& it, unsigned short size);
+} // intpr::
+
+/*
+ * @param out Sink of the printed output, or NULL for stdout.
+ */
+std::optional<intpr::Value> interpret_bytecodes(
+	InterpreterScope& scope,
+	intpr::instructions_t const& instructions,
+	bool is_global,
+	intpr::OutputSink* out = NULL
+);
 
 char* interpret_predefined_input();
 
-// iterator
-//   start: bytecode type
-//   end:   last code of float
-void push_float(std::stack<intpr::Value>& s, bytecodes_t::const_iterator& it, int count);
+void push_str(intpr::Value*& sp, uint64_t size);
+void push_arr(intpr::Value*& sp, uint64_t size);
+void push_arr_and_fill(intpr::Value*& sp, uint64_t dimensions);
 
-void push_str(std::stack<intpr::Value>& s, InterpreterScope& scope);
-void push_arr(std::stack<intpr::Value>& s, InterpreterScope& scope);
-void push_arr_and_fill(std::stack<intpr::Value>& s, InterpreterScope& scope);
-void fill_arr(intpr::Value& arr, std::stack<intpr::Value>& s, std::vector<int> const& dimensions, int current_dimension);
+void push_subscript(intpr::Value*& sp, bool is_string);
 
-void push_subscript(std::stack<intpr::Value>& s, bool is_string, InterpreterScope& scope);
+/*
+ * Raises a runtime error if the index is not inside a string or array of the
+ * given size.
+ */
+void check_bounds(int64_t index, std::size_t size);
 
-void push_string_input(std::stack<intpr::Value>& s);
+/*
+ * Pushes an element of an array whose elements are stored unboxed as T.
+ */
+template <typename T>
+void push_elem(intpr::Value*& sp);
+
+/*
+ * Stores a value in an element of an array whose elements are stored unboxed
+ * as T, and pushes the value.
+ */
+template <typename T>
+void store_elem(intpr::Value*& sp);
 
-intpr::Value pop(std::stack<intpr::Value>& s, InterpreterScope& scope, bool want_var = false);
+intpr::Value pop(intpr::Value*& sp);
 
-char* night_get_line();
@@ -1,21 +1,64 @@
 #pragma once
 
 #include "common/bytecode.hpp"
+#include "instruction.hpp"
 
 #include <unordered_map>
 #include <vector>
+#include <string>
+#include <cstddef>
 
 namespace intpr
 {
 
 struct Value;
 
+/*
+ * Arrays of small integers and booleans store their elements unboxed, in which
+ * case data points to the elements in their own size instead of to values.
+ */
 struct Array
 {
 	Value* data;
 	std::size_t size;
 };
 
+/*
+ * Header stored right before the characters of a string. Values point to the
+ * characters, so a string is still a null terminated C string, but its length
+ * is known without scanning it.
+ */
+struct String
+{
+	std::size_t length : 63;
+
+	// Set when the header is followed by a Concat instead of characters.
+	std::size_t is_concat : 1;
+};
+
+/*
+ * A long concatenation, stored after a String header instead of characters so
+ * its two strings are not copied. It is copied into a single string the first
+ * time its characters are needed, see Heap::flatten().
+ */
+struct Concat
+{
+	char* left;
+	char* right;
+
+	// The copied string once flattened, after which left and right are unset.
+	char* flat;
+};
+
+inline std::size_t str_len(char const* s) { return ((String const*)s - 1)->length; }
+
+/*
+ * A value on the Interpreter's stack, in a frame or in an array.
+ * 
+ * Values carry no type information. The bytecodes generated for an expression
+ * already depend on its type, so the type of a value is always known from the
+ * instruction using it.
+ */
 struct Value
 {
 	union {
@@ -23,58 +66,92 @@ struct Value
 		uint64_t ui;
 		double d;
 		char* s;
-		Array a;
+		Array* a;
+
+		// Element of an array being assigned, pushed by INDEX_A_REF.
 		Value* var;
 	} as;
 
-	bool is_var;
-
-	Value();
+	Value() = default;
 	Value(int64_t _i);
 	Value(uint64_t _ui);
 	Value(double _d);
 	Value(char* _s);
-	Value(Array _a);
-	Value(Value const& _v);
-	Value(Value* var, bool is_var);
-	~Value();
+	Value(Array* _a);
+	Value(Value* _var);
 };
 
+static_assert(sizeof(Value) == 8);
+
 } // intpr::
 
 namespace night {
 	using id_t = uint64_t;
 }
 
-using var_container = std::unordered_map<night::id_t, intpr::Value>;
-
 struct InterpreterFunction;
 using func_container = std::unordered_map<uint64_t, InterpreterFunction>;
 
 struct InterpreterFunction
 {
 	std::vector<night::id_t> param_ids;
-	bytecodes_t codes;
+	intpr::instructions_t instructions;
+
+	// Number of variable slots in a call to the function.
+	std::size_t frame_size;
+
+	bool returns_value;
+
+	// Maximum number of values on the Interpreter's stack during a call to
+	// the function.
+	std::size_t max_stack_size;
 };
 
+/*
+ * The frame of global variables. The variables of function calls are stored on
+ * the Interpreter's stack instead.
+ * 
+ * Every variable is assigned a slot in its frame by StatementScope, so
+ * accessing a variable is indexing into the frame.
+ */
 class InterpreterScope
 {
 public:
 	static func_container funcs;
 
 	InterpreterScope();
-	InterpreterScope(InterpreterScope* _parent);
 
-	intpr::Value& get_variable(night::id_t id);
+	intpr::Value& get_variable(night::id_t id) { return vars[id]; }
+
+	void set_variable(night::id_t id, intpr::Value const& val) { vars[id] = val; }
 
-	void set_variable(night::id_t id, intpr::Value const& val);
+	std::vector<intpr::Value> const& get_variables() const { return vars; }
 
 	static InterpreterScope* global_scope;
 
-private:
-	bool has_variable(night::id_t id);
+	/*
+	 * Returns the interned string equal to s, creating it if it does not exist
+	 * yet. Interned strings are never collected.
+	 */
+	static char* intern_str(std::string const& s);
+
+	/*
+	 * Returns the id of the constant in the constant pool, adding it if an
+	 * equal constant does not exist yet.
+	 */
+	static const_id_t add_const(intpr::Value const& val);
+
+	// Constant pool, indexed by the operand of LOAD_CONST.
+	static std::vector<intpr::Value> consts;
+
+	// Set by code_gen() before the global frame is created.
+	static std::size_t global_frame_size;
 
 private:
-	InterpreterScope* parent;
-	var_container vars;
+	std::vector<intpr::Value> vars;
+
+	static std::unordered_map<std::string, char*> strs;
+
+	// Constants are compared by their bits, as they have no type.
+	static std::unordered_map<uint64_t, const_id_t> const_ids;
 };
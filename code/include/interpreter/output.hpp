@@ -0,0 +1,119 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <cstddef>
+
+namespace intpr
+{
+
+/*
+ * Destination of the output printed by the Interpreter, such as stdout.
+ *
+ * Output is buffered before it reaches a sink, so a sink receives it in
+ * chunks of any size, which may split a print.
+ */
+class OutputSink
+{
+public:
+	virtual ~OutputSink() = default;
+
+	virtual void write(char const* data, std::size_t length) = 0;
+
+	// Called after the buffered output has been written to the sink.
+	virtual void flush() {}
+};
+
+class StdoutSink : public OutputSink
+{
+public:
+	void write(char const* data, std::size_t length) override;
+	void flush() override;
+};
+
+/*
+ * Keeps the output in memory, so it can be inspected once the program ends.
+ */
+class MemorySink : public OutputSink
+{
+public:
+	void write(char const* data, std::size_t length) override;
+
+	std::string const& str() const { return output; }
+
+private:
+	std::string output;
+};
+
+/*
+ * Writes the output to a file descriptor, such as an open file or a pipe,
+ * which is not closed by the sink.
+ */
+class FdSink : public OutputSink
+{
+public:
+	FdSink(int _fd);
+
+	void write(char const* data, std::size_t length) override;
+
+private:
+	int fd;
+};
+
+/*
+ * Passes each chunk of output to a function.
+ */
+class CallbackSink : public OutputSink
+{
+public:
+	using callback_t = std::function<void(char const* data, std::size_t length)>;
+
+	CallbackSink(callback_t const& _callback);
+
+	void write(char const* data, std::size_t length) override;
+
+private:
+	callback_t callback;
+};
+
+/*
+ * Output printed by the Interpreter.
+ *
+ * Prints are not written to the sink directly, as writing every print to
+ * stdout makes each print a system call. Instead prints are copied into a
+ * buffer owned by the Interpreter, which is written to the sink once it is
+ * full, before reading input, and when the program ends or raises an error.
+ */
+class Output
+{
+public:
+	static void write(char const* data, std::size_t length);
+
+	// Returns room for up to length characters at the end of the buffer, so
+	// output can be formatted directly into it. The characters written are
+	// then added to the output with commit().
+	static char* reserve(std::size_t length);
+	static void commit(std::size_t length);
+
+	// Writes the buffer to the sink.
+	static void flush();
+
+	// Sets the sink of the following output, or stdout if the sink is NULL.
+	// Output still in the buffer is written to the previous sink first.
+	static void set_sink(OutputSink* _sink);
+
+	// Whether the buffer is also written after every line, for programs whose
+	// output is read while they are still running.
+	static bool is_line_buffered;
+
+	static constexpr std::size_t capacity = 1 << 16;
+
+private:
+	static char buffer[capacity];
+	static std::size_t size;
+
+	static StdoutSink stdout_sink;
+	static OutputSink* sink;
+};
+
+} // intpr::
@@ -132,7 +132,8 @@ public:
 	Variable(
 		Location const& _loc,
 		std::string const& _name,
-		std::optional<uint64_t> const& _id = std::nullopt
+		std::optional<uint64_t> const& _id = std::nullopt,
+		bool _is_global = false
 	);
 
 	void insert_node(
@@ -155,10 +156,17 @@ public:
 	
 	bytecodes_t generate_codes() const override;
 
+	/*
+	 * @returns The bytecodes to store the value on top of the Interpreter's
+	 *   stack into the variable.
+	 */
+	bytecodes_t generate_store_codes() const;
+
 private:
 	std::string name;
 
 	std::optional<uint64_t> id;
+	bool is_global;
 };
 
 
@@ -196,14 +204,37 @@ public:
 
 	bool is_str() const;
 
+	/*
+	 * Returns the string if this is a string whose characters are all
+	 * constant.
+	 */
+	std::optional<std::string> get_str_literal() const;
+
+	/*
+	 * Sets the type of the array and its elements to the type it is used as.
+	 */
+	void set_type(Type const& _type);
+
 public:
 	std::vector<expr_p> elements;
 
 	// Note: Strings are stored as character arrays, but have special
 	// properties such as being able to work with addition.
 	bool is_str_;
+
+	// Initialized in type_check(), and determines the size of the elements.
+	std::optional<Type> type;
 };
 
+/*
+ * Arrays of integer literals can be used as arrays of any integer type, which
+ * determines the size of their elements. This sets the type of the array
+ * literals in an expression to the type the expression is used as.
+ * 
+ * Must be called after the expression is type checked.
+ */
+void set_arr_type(expr_p const& expr, Type const& type);
+
 
 /*
  * Array element access.
@@ -301,6 +332,13 @@ public:
 	[[nodiscard]] expr_p optimize(StatementScope const& scope) override;
 	bytecodes_t generate_codes() const override;
 
+	/*
+	 * Generates a call in tail position and the return of its value. The call
+	 * reuses the frame of the current function call instead of creating a new
+	 * one. Predefined functions have no frame, so they are called normally.
+	 */
+	bytecodes_t generate_tail_call_codes() const;
+
 private:
 	Token name;
 
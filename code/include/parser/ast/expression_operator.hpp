@@ -138,6 +138,29 @@ public:
 	 */
 	bytecodes_t generate_codes() const override;
 
+	/*
+	 * Returns true if the operator is an assignment and the left hand side
+	 * expression is a Variable.
+	 */
+	bool is_variable_assignment() const;
+
+	/*
+	 * Generates bytes for an assignment to a Variable, storing the result
+	 * directly into the variable without leaving it on the Interpreter's
+	 * stack.
+	 * 
+	 * is_variable_assignment() must be true.
+	 */
+	bytecodes_t generate_variable_assignment_codes() const;
+
+	/*
+	 * Generates bytes for AND and OR, which only evaluate the right hand
+	 * expression when the left hand expression does not decide the result,
+	 *   lhs, JUMP_IF_FALSE, rhs, JUMP, false		for AND
+	 *   lhs, JUMP_IF_FALSE, true, JUMP, rhs		for OR
+	 */
+	bytecodes_t generate_short_circuit_codes() const;
+
 public:
 	BinaryOpType get_type() const;
 
@@ -94,8 +94,7 @@ public:
 	/*
 	 * Bytes are generated in the following order,
 	 *   1) Expression bytes
-	 *   2) ID bytes
-	 *   3) STORE
+	 *   2) STORE_LOCAL or STORE_GLOBAL with the ID
 	 */
 	bytecodes_t generate_codes() const override;
 
@@ -108,6 +107,7 @@ private:
 
 	// Initialized in check().
 	std::optional<night::id_t> id;
+	bool is_global;
 
 	// Initialized in check().
 	std::optional<Type> expr_type;
@@ -146,8 +146,7 @@ public:
 	/*
 	 * Bytes are generated in the following order,
 	 *   1) Expression bytes
-	 *   2) ID bytes
-	 *   3) STORE
+	 *   2) STORE_LOCAL or STORE_GLOBAL with the ID
 	 */
 	bytecodes_t generate_codes() const override;
 
@@ -167,6 +166,7 @@ private:
 
 	// Initialized in check().
 	std::optional<night::id_t> id;
+	bool is_global;
 
 	// Initialized in check().
 	std::optional<Type> expr_type;
@@ -192,10 +192,8 @@ public:
 
 	/**
 	 * CONDITION		boolean expression for conditional
-	 * INT8				8 bit integer value for JUMP_IF_FALSE
 	 * JUMP_IF_FALSE	jumps to first line after JUMP
 	 *   ...			conditional code
-	 *   INT8			8 bit integer value for JUMP
 	 *   JUMP			jumps to first line after conditional chain
 	 */
 	bytecodes_t generate_codes() const override;
@@ -223,11 +221,9 @@ public:
 
 	/** 
 	 * CONDITION		boolean expression for while loop condition
-	 * INT8				8 bit integer value for JUMP_IF_FALSE
-	 * JUMP_IF_FALSE	jumps to first line after JUMP_N
+	 * JUMP_IF_FALSE	jumps to first line after JUMP
 	 *   ...			while loop code
-	 *   INT8			8 bit integer value for JUMP_N
-	 *   JUMP_N			jumps to first line of CONDITION
+	 *   JUMP			jumps to first line of CONDITION
 	 */
 	bytecodes_t generate_codes() const override;
 
@@ -255,6 +251,17 @@ public:
 	bool optimize(StatementScope& scope) override;
 	bytecodes_t generate_codes() const override;
 
+private:
+	/*
+	 * Indexing a string with the loop variable does not need to check its
+	 * bounds when the loop is of the form,
+	 *   for (i int32 = 0; i < len(s); i += 1)
+	 * and the block does not store to i or s. The loop can also start at any
+	 * non-negative constant, increase by any non-negative constant, and end
+	 * at a constant subtracted from or dividing the length.
+	 */
+	void remove_bounds_checks(bytecodes_t const& init_codes, bytecodes_t& loop_codes) const;
+
 private:
 	VariableInit var_init;
 	While loop;
@@ -308,6 +315,9 @@ private:
 
 	// Initialized in check().
 	std::vector<night::id_t> parameter_ids;
+
+	// Initialized in check().
+	night::id_t frame_size;
 };
 
 
@@ -350,10 +360,19 @@ public:
 	bool optimize(StatementScope& scope) override;
 	[[nodiscard]]
 	expr_p optimize(StatementScope const& scope) override;
+
+	/*
+	 * The value of the expression is unused, so it is popped off the
+	 * Interpreter's stack. Assignments to variables do not leave a value to
+	 * begin with.
+	 */
 	bytecodes_t generate_codes() const override;
 
 private:
 	expr::expr_p expr;
+
+	// Initialized in type_check().
+	std::optional<Type> expr_type;
 };
 
 } // expr::
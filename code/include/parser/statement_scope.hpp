@@ -5,6 +5,7 @@
 #include "common/error.hpp"
 
 #include <unordered_map>
+#include <memory>
 #include <vector>
 #include <optional>
 #include <string>
@@ -23,9 +24,14 @@ using id_t = uint64_t;
 
 struct StatementVariable
 {
+	// Index of the variable's slot in its frame.
 	night::id_t id;
 	Type type;
 	
+	// Global variables are accessed directly from the global scope by the
+	// Interpreter, while all other variables are local to their function.
+	bool is_global;
+	
 	// Keep track of the number of times used so unused variables can be
 	// eliminated in the optimizing stage.
 	unsigned times_used;
@@ -43,19 +49,31 @@ struct StatementFunction
 class StatementScope
 {
 public:
+	/*
+	 * Creates the global scope, and the global frame.
+	 */
 	StatementScope();
 
+	/*
+	 * Creates a block scope, such as the scope of a conditional or loop.
+	 * Variables created in a block scope belong to the same frame as variables
+	 * created in the parent scope.
+	 */
 	StatementScope(
 		StatementScope const& parent_scope
 	);
 
+	/*
+	 * Creates the scope of a function's body, and the function's frame.
+	 */
 	StatementScope(
 		StatementScope const& parent_scope,
 		std::optional<Type> const& _return_type
 	);
 
 	/*
-	 * Creates a new variables and returns its ID.
+	 * Creates a new variable and returns its ID, which is the index of its
+	 * slot in the frame.
 	 * Returns nullopt if the variable is already defined or the maximum
 	 * allowed variables has been reached.
 	 * 
@@ -90,10 +108,34 @@ public:
 		std::optional<Type> const& _return_type
 	);
 
+	/*
+	 * Returns true if variables created in this scope are global.
+	 */
+	bool is_global() const;
+
+	/*
+	 * Returns the number of slots needed by the frame this scope belongs to,
+	 * including the slots of all block scopes created so far.
+	 */
+	night::id_t get_frame_size() const;
+
 	static scope_func_container functions;
 
 	std::optional<Type> return_type;
 
 private:
 	scope_var_container variables;
+
+	bool global;
+
+	/*
+	 * Variables are stored in slots of a frame, either the global frame or the
+	 * frame of a function call. Block scopes continue from the next slot of
+	 * their parent scope, so once a block scope ends, its slots are reused by
+	 * the next block scope.
+	 */
+	night::id_t next_slot;
+
+	// Shared by all scopes of the same frame.
+	std::shared_ptr<night::id_t> frame_size;
 };
\ No newline at end of file
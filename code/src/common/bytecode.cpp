@@ -2,6 +2,7 @@
 
 #include <limits>
 #include <string>
+#include <assert.h>
 
 std::string night::to_str(bytecode_t type)
 {
@@ -54,32 +55,206 @@ std::string night::to_str(bytecode_t type)
 	case ByteType_NE_F: return "NE_F";
 	case ByteType_NE_S: return "NE_S";
 
-	case BytecodeType_AND: return "AND";
-	case BytecodeType_OR: return "OR";
 
 	case BytecodeType_INDEX_S: return "INDEX_S";
+	case BytecodeType_INDEX_S_UNCHECKED: return "INDEX_S_UNCHECKED";
 	case BytecodeType_INDEX_A: return "INDEX_A";
+	case BytecodeType_INDEX_A_REF: return "INDEX_A_REF";
+	case BytecodeType_INDEX_A_I8: return "INDEX_A_I8";
+	case BytecodeType_INDEX_A_U8: return "INDEX_A_U8";
+	case BytecodeType_INDEX_A_I16: return "INDEX_A_I16";
+	case BytecodeType_INDEX_A_U16: return "INDEX_A_U16";
+	case BytecodeType_INDEX_A_I32: return "INDEX_A_I32";
+	case BytecodeType_INDEX_A_U32: return "INDEX_A_U32";
 
-	case ByteType_LOAD: return "LOAD";
-	case BytecodeType_LOAD_ELEM: return "LOAD_ELEM";
+	case BytecodeType_LOAD_LOCAL: return "LOAD_LOCAL";
+	case BytecodeType_LOAD_GLOBAL: return "LOAD_GLOBAL";
+	case BytecodeType_LOAD_CONST: return "LOAD_CONST";
 
-	case ByteType_STORE: return "STORE";
-	case BytecodeType_STORE_INDEX_A: return "STORE_INDEX_A";
-	case BytecodeType_STORE_INDEX_S: return "STORE_INDEX_S";
+	case ByteType_DUP: return "DUP";
+	case ByteType_DUP2: return "DUP2";
+	case BytecodeType_DEREF: return "DEREF";
+	case BytecodeType_POP: return "POP";
+
+	case BytecodeType_STORE_LOCAL: return "STORE_LOCAL";
+	case BytecodeType_STORE_GLOBAL: return "STORE_GLOBAL";
+	case ByteType_STORE_INPLACE: return "STORE_INPLACE";
+	case BytecodeType_STORE_INDEX_A_8: return "STORE_INDEX_A_8";
+	case BytecodeType_STORE_INDEX_A_16: return "STORE_INDEX_A_16";
+	case BytecodeType_STORE_INDEX_A_32: return "STORE_INDEX_A_32";
 
 	case BytecodeType_ALLOCATE_STR: return "ALLOCATE_STR";
 	case BytecodeType_ALLOCATE_ARR: return "ALLOCATE_ARR";
 	case BytecodeType_ALLOCATE_ARR_AND_FILL: return "ALLOCATE_ARR_AND_FILL";
-	case BytecodeType_FREE_STR: return "FREE_STR";
-	case BytecodeType_FREE_ARR: return "FREE_ARR";
 
 	case BytecodeType_JUMP: return "JUMP";
-	case ByteType_JUMP_N: return "JUMP_N";
 	case BytecodeType_JUMP_IF_FALSE: return "JUMP_IF_FALSE";
 
 	case BytecodeType_RETURN: return "RETURN";
 	case BytecodeType_CALL: return "CALL";
+	case BytecodeType_TAIL_CALL: return "TAIL_CALL";
+
+	case BytecodeType_ADD_CONST_I: return "ADD_CONST_I";
+	case BytecodeType_INC_LOCAL: return "INC_LOCAL";
+	case BytecodeType_INC_GLOBAL: return "INC_GLOBAL";
+	case BytecodeType_LT_I_JUMP_IF_FALSE: return "LT_I_JUMP_IF_FALSE";
+	case BytecodeType_LE_I_JUMP_IF_FALSE: return "LE_I_JUMP_IF_FALSE";
+	case BytecodeType_GT_I_JUMP_IF_FALSE: return "GT_I_JUMP_IF_FALSE";
+	case BytecodeType_GE_I_JUMP_IF_FALSE: return "GE_I_JUMP_IF_FALSE";
+	case BytecodeType_EQ_I_JUMP_IF_FALSE: return "EQ_I_JUMP_IF_FALSE";
+	case BytecodeType_NE_I_JUMP_IF_FALSE: return "NE_I_JUMP_IF_FALSE";
 
 	default: return "UNKNOWN";
 	}
+}
+
+std::size_t night::operand_size(bytecode_t type)
+{
+	switch (type)
+	{
+	case ByteType_sINT1: case ByteType_uINT1: return 1;
+	case ByteType_sINT2: case ByteType_uINT2: return 2;
+	case ByteType_sINT4: case ByteType_uINT4: return 4;
+	case ByteType_sINT8: case ByteType_uINT8: return 8;
+	case ByteType_FLT4: return 4;
+	case ByteType_FLT8: return 8;
+
+	case BytecodeType_LOAD_LOCAL:
+	case BytecodeType_LOAD_GLOBAL:
+	case BytecodeType_STORE_LOCAL:
+	case BytecodeType_STORE_GLOBAL:
+		return sizeof(variable_id_t);
+
+	case BytecodeType_LOAD_CONST:
+		return sizeof(const_id_t);
+
+	case BytecodeType_JUMP:
+	case BytecodeType_JUMP_IF_FALSE:
+		return sizeof(jump_offset_t);
+
+	default: return 0;
+	}
+}
+
+bytecodes_t night::jump_to_bytes(bytecode_t jump_type, jump_offset_t offset)
+{
+	assert(jump_type == BytecodeType_JUMP || jump_type == BytecodeType_JUMP_IF_FALSE);
+
+	bytecodes_t bytes(jump_size);
+	bytes[0] = jump_type;
+	set_jump_offset(bytes, 0, offset);
+
+	return bytes;
+}
+
+bytecodes_t night::variable_to_bytes(bytecode_t variable_type, variable_id_t id)
+{
+	assert(variable_type == BytecodeType_LOAD_LOCAL || variable_type == BytecodeType_LOAD_GLOBAL ||
+		   variable_type == BytecodeType_STORE_LOCAL || variable_type == BytecodeType_STORE_GLOBAL);
+
+	bytecodes_t bytes;
+	bytes.reserve(variable_size);
+
+	bytes.push_back(variable_type);
+	for (std::size_t i = 0; i < sizeof(variable_id_t); ++i)
+	{
+		bytes.push_back(id & 0xFF);
+		id >>= 8;
+	}
+
+	return bytes;
+}
+
+bytecodes_t night::const_to_bytes(const_id_t id)
+{
+	bytecodes_t bytes;
+	bytes.reserve(sizeof(bytecode_t) + sizeof(const_id_t));
+
+	bytes.push_back(BytecodeType_LOAD_CONST);
+	for (std::size_t i = 0; i < sizeof(const_id_t); ++i)
+	{
+		bytes.push_back(id & 0xFF);
+		id >>= 8;
+	}
+
+	return bytes;
+}
+
+std::size_t night::arr_elem_size(Type const& arr_type)
+{
+	assert(arr_type.is_arr());
+
+	if (arr_type.get_dim() != 1)
+		return sizeof(uint64_t);
+
+	switch (arr_type.get_prim())
+	{
+	case Primitive::BOOL:
+	case Primitive::INT8:
+	case Primitive::uINT8:
+		return sizeof(uint8_t);
+	case Primitive::INT16:
+	case Primitive::uINT16:
+		return sizeof(uint16_t);
+	case Primitive::INT32:
+	case Primitive::uINT32:
+		return sizeof(uint32_t);
+	default:
+		return sizeof(uint64_t);
+	}
+}
+
+bytecode_t night::index_arr_type(Type const& arr_type)
+{
+	assert(arr_type.is_arr());
+
+	if (arr_type.get_dim() != 1)
+		return BytecodeType_INDEX_A;
+
+	switch (arr_type.get_prim())
+	{
+	case Primitive::INT8: return BytecodeType_INDEX_A_I8;
+	case Primitive::BOOL:
+	case Primitive::uINT8: return BytecodeType_INDEX_A_U8;
+	case Primitive::INT16: return BytecodeType_INDEX_A_I16;
+	case Primitive::uINT16: return BytecodeType_INDEX_A_U16;
+	case Primitive::INT32: return BytecodeType_INDEX_A_I32;
+	case Primitive::uINT32: return BytecodeType_INDEX_A_U32;
+	default: return BytecodeType_INDEX_A;
+	}
+}
+
+jump_offset_t night::get_jump_offset(bytecodes_t const& codes, std::size_t index)
+{
+	assert(index + jump_size <= codes.size());
+
+	uint32_t offset = 0;
+	for (std::size_t i = 0; i < sizeof(jump_offset_t); ++i)
+		offset |= (uint32_t)codes[index + 1 + i] << (8 * i);
+
+	return (jump_offset_t)offset;
+}
+
+void night::set_jump_offset(bytecodes_t& codes, std::size_t index, jump_offset_t offset)
+{
+	assert(index + jump_size <= codes.size());
+	assert(codes[index] == BytecodeType_JUMP || codes[index] == BytecodeType_JUMP_IF_FALSE);
+
+	uint32_t bits = (uint32_t)offset;
+	for (std::size_t i = 0; i < sizeof(jump_offset_t); ++i)
+		codes[index + 1 + i] = (bits >> (8 * i)) & 0xFF;
+}
+
+void night::link_jumps(bytecodes_t& codes)
+{
+	for (std::size_t i = 0; i < codes.size(); i += 1 + operand_size(codes[i]))
+	{
+		if (codes[i] != BytecodeType_JUMP && codes[i] != BytecodeType_JUMP_IF_FALSE)
+			continue;
+
+		jump_offset_t target = (jump_offset_t)(i + jump_size) + get_jump_offset(codes, i);
+		assert(0 <= target && (std::size_t)target <= codes.size());
+
+		set_jump_offset(codes, i, target);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "interpreter/format.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <assert.h>
+
+// Both digits of every number from 0 to 99, so integers are formatted two
+// digits at a time.
+static char const digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static std::size_t count_digits(uint64_t ui)
+{
+	std::size_t count = 1;
+	for (; ui >= 100; ui /= 100)
+		count += 2;
+
+	return count + (ui >= 10);
+}
+
+std::size_t intpr::format_uint(char* buf, uint64_t ui)
+{
+	std::size_t length = count_digits(ui);
+	char* c = buf + length;
+
+	while (ui >= 100)
+	{
+		std::size_t pair = (ui % 100) * 2;
+		ui /= 100;
+
+		*--c = digit_pairs[pair + 1];
+		*--c = digit_pairs[pair];
+	}
+
+	if (ui >= 10)
+	{
+		*--c = digit_pairs[ui * 2 + 1];
+		*--c = digit_pairs[ui * 2];
+	}
+	else
+	{
+		*--c = (char)('0' + ui);
+	}
+
+	return length;
+}
+
+std::size_t intpr::format_int(char* buf, int64_t i)
+{
+	if (i >= 0)
+		return format_uint(buf, (uint64_t)i);
+
+	// Negated as unsigned, which also holds the magnitude of INT64_MIN
+	*buf = '-';
+	return 1 + format_uint(buf + 1, 0 - (uint64_t)i);
+}
+
+std::size_t intpr::format_float(char* buf, double d)
+{
+	auto result = std::to_chars(buf, buf + max_float_length, d, std::chars_format::general, 17);
+	assert(result.ec == std::errc());
+
+	return result.ptr - buf;
+}
+
+std::size_t intpr::format_fixed(char* buf, float f)
+{
+	auto result = std::to_chars(buf, buf + max_fixed_length, (double)f, std::chars_format::fixed, 6);
+	assert(result.ec == std::errc());
+
+	return result.ptr - buf;
+}
@@ -0,0 +1,272 @@
+#include "interpreter/heap.hpp"
+#include "interpreter/interpreter_scope.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// Minimum heap size before the first collection, so short scripts never
+// collect at all.
+static constexpr std::size_t min_collection = 1 << 20;
+
+std::vector<intpr::Heap::Object> intpr::Heap::objects = {};
+std::vector<void*> intpr::Heap::small_str_blocks = {};
+std::size_t intpr::Heap::bytes_allocated = 0;
+std::size_t intpr::Heap::next_collection = min_collection;
+
+char* intpr::Heap::allocate_str(std::size_t length)
+{
+	std::size_t size = length <= small_str_length ? small_str_size : sizeof(String) + length + 1;
+	String* str;
+
+	if (size == small_str_size && !small_str_blocks.empty())
+	{
+		str = (String*)small_str_blocks.back();
+		small_str_blocks.pop_back();
+
+		objects.push_back({ (uintptr_t)str, size, ObjectType::STR, false });
+		bytes_allocated += size;
+	}
+	else
+	{
+		str = (String*)allocate(size, ObjectType::STR);
+	}
+
+	// The characters directly follow the header, so a string points inside its
+	// object
+	str->length = length;
+	str->is_concat = false;
+
+	char* s = (char*)(str + 1);
+	s[length] = '\0';
+
+	return s;
+}
+
+intpr::Array* intpr::Heap::allocate_arr(std::size_t size, std::size_t elem_size)
+{
+	// The elements directly follow the array, so a reference to an element
+	// points inside the array's object
+	std::size_t bytes = sizeof(Array) + size * elem_size;
+
+	Array* arr = (Array*)allocate(bytes, elem_size == sizeof(Value) ? ObjectType::ARR : ObjectType::UNBOXED_ARR);
+	arr->data = (Value*)(arr + 1);
+	arr->size = size;
+	memset(arr->data, 0, size * elem_size);
+
+	return arr;
+}
+
+char* intpr::Heap::concat(char* left, char* right)
+{
+	std::size_t left_len = str_len(left);
+	std::size_t right_len = str_len(right);
+	std::size_t length = left_len + right_len;
+
+	if (length <= min_concat_length)
+	{
+		// Only longer strings can be a Concat
+		assert(!((String*)left - 1)->is_concat && !((String*)right - 1)->is_concat);
+
+		char* s = allocate_str(length);
+		memcpy(s, left, left_len);
+		memcpy(s + left_len, right, right_len);
+
+		return s;
+	}
+
+	String* str = (String*)allocate(sizeof(String) + sizeof(Concat), ObjectType::CONCAT);
+	str->length = length;
+	str->is_concat = true;
+
+	Concat* concat = (Concat*)(str + 1);
+	*concat = { left, right, nullptr };
+
+	return (char*)concat;
+}
+
+char* intpr::Heap::flatten(char* s)
+{
+	Concat* concat = (Concat*)s;
+	if (concat->flat)
+		return concat->flat;
+
+	char* flat = allocate_str(str_len(s));
+	std::size_t length = 0;
+
+	// Concatenations are usually nested on the left, so the strings are
+	// copied with a stack instead of recursion, starting from the back
+	std::vector<char*> strs = { concat->right, concat->left };
+
+	while (!strs.empty())
+	{
+		char* str = strs.back();
+		strs.pop_back();
+
+		if (((String*)str - 1)->is_concat)
+		{
+			Concat* part = (Concat*)str;
+
+			if (!part->flat)
+			{
+				strs.push_back(part->right);
+				strs.push_back(part->left);
+				continue;
+			}
+
+			str = part->flat;
+		}
+
+		memcpy(flat + length, str, str_len(str));
+		length += str_len(str);
+	}
+
+	*concat = { nullptr, nullptr, flat };
+
+	return flat;
+}
+
+intpr::Array* intpr::Heap::allocate_arr(std::vector<std::size_t> const& dimensions, std::size_t elem_size)
+{
+	assert(!dimensions.empty());
+
+	if (dimensions.size() == 1)
+		return allocate_arr(dimensions[0], elem_size);
+
+	// Every array except the last dimension holds the arrays of the next
+	// dimension as its elements
+	std::size_t arrs_count = 0;
+	std::size_t values_count = 0;
+	std::size_t level_count = 1;
+
+	for (std::size_t d = 0; d < dimensions.size(); ++d)
+	{
+		arrs_count += level_count;
+		level_count *= dimensions[d];
+
+		if (d + 1 < dimensions.size())
+			values_count += level_count;
+	}
+
+	std::size_t bytes = arrs_count * sizeof(Array) + values_count * sizeof(Value) + level_count * elem_size;
+
+	Array* arrs = (Array*)allocate(bytes, ObjectType::ARR);
+	memset(arrs, 0, bytes);
+
+	char* data = (char*)(arrs + arrs_count);
+	Array* level = arrs;
+	level_count = 1;
+
+	for (std::size_t d = 0; d < dimensions.size(); ++d)
+	{
+		Array* next_level = level + level_count;
+		bool is_last = d + 1 == dimensions.size();
+
+		for (std::size_t i = 0; i < level_count; ++i)
+		{
+			level[i] = { (Value*)data, dimensions[d] };
+
+			if (!is_last)
+			{
+				for (std::size_t j = 0; j < dimensions[d]; ++j)
+					level[i].data[j].as.a = next_level + i * dimensions[d] + j;
+			}
+
+			data += dimensions[d] * (is_last ? elem_size : sizeof(Value));
+		}
+
+		level = next_level;
+		level_count *= dimensions[d];
+	}
+
+	return arrs;
+}
+
+void* intpr::Heap::allocate(std::size_t size, ObjectType type)
+{
+	void* ptr = malloc(size);
+	if (!ptr)
+		exit(1);
+
+	objects.push_back({ (uintptr_t)ptr, size, type, false });
+	bytes_allocated += size;
+
+	return ptr;
+}
+
+void intpr::Heap::collect(Value const* stack_begin, Value const* stack_top)
+{
+	std::sort(objects.begin(), objects.end(), [](Object const& a, Object const& b) {
+		return a.address < b.address;
+	});
+
+	std::vector<Values> unmarked = { { stack_begin, (std::size_t)(stack_top - stack_begin) } };
+
+	if (InterpreterScope::global_scope)
+	{
+		auto const& vars = InterpreterScope::global_scope->get_variables();
+		unmarked.push_back({ vars.data(), vars.size() });
+	}
+
+	while (!unmarked.empty())
+	{
+		Values values = unmarked.back();
+		unmarked.pop_back();
+
+		for (std::size_t i = 0; i < values.size; ++i)
+			mark(values.data[i], unmarked);
+	}
+
+	std::size_t live = 0;
+	for (Object& object : objects)
+	{
+		if (object.is_marked)
+		{
+			object.is_marked = false;
+			objects[live++] = object;
+			continue;
+		}
+
+		bytes_allocated -= object.size;
+
+		if (object.type == ObjectType::STR && object.size == small_str_size)
+			small_str_blocks.push_back((void*)object.address);
+		else
+			free((void*)object.address);
+	}
+
+	objects.resize(live);
+
+	next_collection = std::max(2 * bytes_allocated, min_collection);
+}
+
+void intpr::Heap::mark(Value const& value, std::vector<Values>& unmarked)
+{
+	// Find the object starting at or before the address
+	auto it = std::upper_bound(objects.begin(), objects.end(), value.as.ui,
+		[](uintptr_t address, Object const& object) { return address < object.address; });
+
+	if (it == objects.begin())
+		return;
+
+	--it;
+	if (value.as.ui >= it->address + it->size || it->is_marked)
+		return;
+
+	it->is_marked = true;
+
+	// The whole block of an array is marked, as a multi-dimensional array also
+	// stores the elements of its rows. Unboxed elements hold no values, but are
+	// marked conservatively like any other integer. The strings of a Concat are
+	// marked like the elements of an array.
+	if (it->type == ObjectType::ARR)
+	{
+		unmarked.push_back({ (Value const*)it->address, it->size / sizeof(Value) });
+	}
+	else if (it->type == ObjectType::CONCAT)
+	{
+		unmarked.push_back({ (Value const*)((String const*)it->address + 1), 3 });
+	}
+}
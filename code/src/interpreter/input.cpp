@@ -0,0 +1,79 @@
+#include "interpreter/input.hpp"
+#include "interpreter/heap.hpp"
+
+#include <string>
+#include <errno.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define read_fd _read
+#else
+#include <unistd.h>
+#define read_fd ::read
+#endif
+
+char intpr::Input::buffer[capacity];
+std::size_t intpr::Input::begin = 0;
+std::size_t intpr::Input::end = 0;
+
+/*
+ * Creates a string of the start of a line that was split across blocks,
+ * followed by the rest of the line.
+ */
+static char* create_line(std::string const& start, char const* rest, std::size_t rest_length)
+{
+	char* s = intpr::Heap::allocate_str(start.length() + rest_length);
+	memcpy(s, start.data(), start.length());
+
+	// rest is NULL once there is no more input
+	if (rest_length)
+		memcpy(s + start.length(), rest, rest_length);
+
+	return s;
+}
+
+char* intpr::Input::read_line()
+{
+	// Only used by lines that do not end in the current block
+	std::string start;
+
+	while (true)
+	{
+		char const* data = buffer + begin;
+		std::size_t length = end - begin;
+
+		if (auto newline = (char const*)memchr(data, '\n', length))
+		{
+			length = newline - data;
+			begin += length + 1;
+
+			return create_line(start, data, length);
+		}
+
+		start.append(data, length);
+		begin = end;
+
+		if (!fill())
+			return create_line(start, nullptr, 0);
+	}
+}
+
+bool intpr::Input::fill()
+{
+	// Unlike fread(), a read returns as soon as some input is available, so
+	// interactive input is not held back until a whole block is typed
+	while (true)
+	{
+		auto length = read_fd(0, buffer, (unsigned)capacity);
+
+		if (length < 0 && errno == EINTR)
+			continue;
+		if (length <= 0)
+			return false;
+
+		begin = 0;
+		end = (std::size_t)length;
+		return true;
+	}
+}
@@ -0,0 +1,414 @@
+#include "interpreter/instruction.hpp"
+#include "interpreter/interpreter_scope.hpp"
+#include "common/bytecode.hpp"
+#include "common/debug.hpp"
+#include "language.hpp"
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <assert.h>
+
+/*
+ * Reads a little endian integer stored in the codes following a bytecode type.
+ * Signed integers are sign extended.
+ * 
+ * @param index Index of the bytecode type.
+ */
+template <typename T>
+static T decode_int(bytecodes_t const& codes, std::size_t index)
+{
+	assert(index + sizeof(T) < codes.size());
+
+	std::make_unsigned_t<T> num = 0;
+	for (std::size_t i = 0; i < sizeof(T); ++i)
+		num |= (std::make_unsigned_t<T>)codes[index + 1 + i] << (8 * i);
+
+	return (T)num;
+}
+
+/*
+ * Reads a float stored in the codes following a bytecode type.
+ * 
+ * @param index Index of the bytecode type.
+ */
+template <typename T>
+static double decode_flt(bytecodes_t const& codes, std::size_t index)
+{
+	assert(index + sizeof(T) < codes.size());
+
+	T f;
+	std::memcpy(&f, &codes[index + 1], sizeof(T));
+
+	return (double)f;
+}
+
+static bool is_int(intpr::Instruction const& instruction)
+{
+	return instruction.type == ByteType_sINT8 || instruction.type == ByteType_uINT8;
+}
+
+/*
+ * Returns the bytecode type of the superinstruction fusing the comparison with
+ * a following JUMP_IF_FALSE, or 0 if there is none.
+ */
+static bytecode_t compare_jump_type(bytecode_t compare_type)
+{
+	switch (compare_type)
+	{
+	case ByteType_LT_I: return BytecodeType_LT_I_JUMP_IF_FALSE;
+	case ByteType_LE_I: return BytecodeType_LE_I_JUMP_IF_FALSE;
+	case ByteType_GT_I: return BytecodeType_GT_I_JUMP_IF_FALSE;
+	case ByteType_GE_I: return BytecodeType_GE_I_JUMP_IF_FALSE;
+	case ByteType_EQ_I: return BytecodeType_EQ_I_JUMP_IF_FALSE;
+	case ByteType_NE_I: return BytecodeType_NE_I_JUMP_IF_FALSE;
+	default: return 0;
+	}
+}
+
+/*
+ * Instructions whose operand is the index of the instruction to jump to.
+ */
+static bool is_jump(bytecode_t type)
+{
+	return type == BytecodeType_JUMP || type == BytecodeType_JUMP_IF_FALSE ||
+		   (type >= BytecodeType_LT_I_JUMP_IF_FALSE && type <= BytecodeType_NE_I_JUMP_IF_FALSE);
+}
+
+/*
+ * Returns the value added to an integer by a LOAD_CONST followed by ADD_I or
+ * SUB_I, starting at the index, if there is one.
+ */
+static std::optional<uint64_t> get_const_addition(intpr::instructions_t const& instructions, std::size_t index)
+{
+	if (index + 1 >= instructions.size() || instructions[index].type != BytecodeType_LOAD_CONST)
+		return std::nullopt;
+
+	uint64_t value = instructions[index].operand.ui;
+
+	switch (instructions[index + 1].type)
+	{
+	case ByteType_ADD_I: return value;
+	case ByteType_SUB_I: return 0 - value;
+	default: return std::nullopt;
+	}
+}
+
+/*
+ * Fuses sequences of instructions into superinstructions, see decode().
+ */
+static void fuse(intpr::instructions_t& instructions)
+{
+	// Instructions in the middle of a fused sequence can not be jumped to.
+	std::vector<bool> is_target(instructions.size() + 1, false);
+	for (auto const& instruction : instructions)
+	{
+		if (is_jump(instruction.type))
+			is_target[instruction.operand.ui] = true;
+	}
+
+	auto is_fusable = [&](std::size_t index, std::size_t length) {
+		if (index + length > instructions.size())
+			return false;
+
+		for (std::size_t i = index + 1; i < index + length; ++i)
+		{
+			if (is_target[i])
+				return false;
+		}
+
+		return true;
+	};
+
+	// Maps the index of each instruction to the index of its fused instruction.
+	std::vector<std::size_t> fused_indices(instructions.size() + 1);
+	intpr::instructions_t fused;
+	fused.reserve(instructions.size());
+
+	for (std::size_t i = 0; i < instructions.size();)
+	{
+		intpr::Instruction instruction = instructions[i];
+		std::size_t length = 1;
+
+		bytecode_t type = instruction.type;
+		bool is_load = type == BytecodeType_LOAD_LOCAL || type == BytecodeType_LOAD_GLOBAL;
+		bytecode_t store = type == BytecodeType_LOAD_LOCAL ? BytecodeType_STORE_LOCAL : BytecodeType_STORE_GLOBAL;
+
+		if (auto addition = get_const_addition(instructions, i + 1);
+			is_load && addition.has_value() && is_fusable(i, 4) &&
+			instructions[i + 3].type == store && instructions[i + 3].operand.ui == instruction.operand.ui &&
+			instruction.operand.ui <= UINT32_MAX)
+		{
+			instruction.type = type == BytecodeType_LOAD_LOCAL ? BytecodeType_INC_LOCAL : BytecodeType_INC_GLOBAL;
+			instruction.id = (uint32_t)instruction.operand.ui;
+			instruction.operand.ui = *addition;
+			length = 4;
+		}
+		else if (auto addition = get_const_addition(instructions, i); addition.has_value() && is_fusable(i, 2))
+		{
+			instruction.type = BytecodeType_ADD_CONST_I;
+			instruction.operand.ui = *addition;
+			length = 2;
+		}
+		else if (compare_jump_type(type) && is_fusable(i, 2) && instructions[i + 1].type == BytecodeType_JUMP_IF_FALSE)
+		{
+			instruction.type = compare_jump_type(type);
+			instruction.operand.ui = instructions[i + 1].operand.ui;
+			length = 2;
+		}
+
+		for (std::size_t j = i; j < i + length; ++j)
+			fused_indices[j] = fused.size();
+
+		fused.push_back(instruction);
+		i += length;
+	}
+
+	fused_indices[instructions.size()] = fused.size();
+
+	for (auto& instruction : fused)
+	{
+		if (is_jump(instruction.type))
+			instruction.operand.ui = fused_indices[instruction.operand.ui];
+	}
+
+	instructions = std::move(fused);
+}
+
+intpr::instructions_t intpr::decode(bytecodes_t const& codes)
+{
+	instructions_t instructions;
+	instructions.reserve(codes.size() / 2);
+
+	// Maps the index of each bytecode type to the index of its instruction, so
+	// jumps can be converted. Jumps can also target the end of the codes.
+	std::vector<std::size_t> instruction_indices(codes.size() + 1);
+
+	for (std::size_t i = 0; i < codes.size(); i += 1 + night::operand_size(codes[i]))
+	{
+		instruction_indices[i] = instructions.size();
+
+		Instruction instruction;
+		instruction.type = codes[i];
+		instruction.id = 0;
+		instruction.operand.ui = 0;
+
+		switch (codes[i])
+		{
+		case ByteType_sINT1: instruction.type = ByteType_sINT8; instruction.operand.i = decode_int<int8_t>(codes, i); break;
+		case ByteType_sINT2: instruction.type = ByteType_sINT8; instruction.operand.i = decode_int<int16_t>(codes, i); break;
+		case ByteType_sINT4: instruction.type = ByteType_sINT8; instruction.operand.i = decode_int<int32_t>(codes, i); break;
+		case ByteType_sINT8: instruction.type = ByteType_sINT8; instruction.operand.i = decode_int<int64_t>(codes, i); break;
+
+		case ByteType_uINT1: instruction.type = ByteType_uINT8; instruction.operand.ui = decode_int<uint8_t>(codes, i); break;
+		case ByteType_uINT2: instruction.type = ByteType_uINT8; instruction.operand.ui = decode_int<uint16_t>(codes, i); break;
+		case ByteType_uINT4: instruction.type = ByteType_uINT8; instruction.operand.ui = decode_int<uint32_t>(codes, i); break;
+		case ByteType_uINT8: instruction.type = ByteType_uINT8; instruction.operand.ui = decode_int<uint64_t>(codes, i); break;
+
+		case ByteType_FLT4: instruction.type = ByteType_FLT8; instruction.operand.d = decode_flt<float>(codes, i); break;
+		case ByteType_FLT8: instruction.type = ByteType_FLT8; instruction.operand.d = decode_flt<double>(codes, i); break;
+
+		case BytecodeType_LOAD_LOCAL:
+		case BytecodeType_LOAD_GLOBAL:
+		case BytecodeType_STORE_LOCAL:
+		case BytecodeType_STORE_GLOBAL:
+			instruction.operand.ui = decode_int<variable_id_t>(codes, i);
+			break;
+
+		case BytecodeType_LOAD_CONST:
+			// The constant is copied into the instruction, so loading it does
+			// not access the constant pool
+			instruction.operand.ui = InterpreterScope::consts[decode_int<const_id_t>(codes, i)].as.ui;
+			break;
+
+		case BytecodeType_CALL:
+		case BytecodeType_TAIL_CALL:
+		case BytecodeType_ALLOCATE_STR:
+		case BytecodeType_ALLOCATE_ARR:
+		case BytecodeType_ALLOCATE_ARR_AND_FILL:
+			// The function id or size is always generated right before the
+			// bytecode type, and no jump can target the bytecode type itself.
+			if (instructions.empty() || !is_int(instructions.back()))
+				throw debug::unhandled_case(night::to_str(codes[i]));
+
+			instruction.operand.ui = instructions.back().operand.ui;
+			instructions.pop_back();
+			break;
+
+		case BytecodeType_JUMP:
+		case BytecodeType_JUMP_IF_FALSE:
+			// Converted to an instruction index once all instructions are decoded.
+			instruction.operand.ui = (uint64_t)night::get_jump_offset(codes, i);
+			break;
+
+		default:
+			break;
+		}
+
+		instructions.push_back(instruction);
+	}
+
+	instruction_indices[codes.size()] = instructions.size();
+
+	for (Instruction& instruction : instructions)
+	{
+		if (instruction.type == BytecodeType_JUMP || instruction.type == BytecodeType_JUMP_IF_FALSE)
+			instruction.operand.ui = instruction_indices[instruction.operand.ui];
+	}
+
+	fuse(instructions);
+
+	return instructions;
+}
+
+/*
+ * Returns the change in the number of values on the Interpreter's stack after
+ * interpreting the instruction.
+ */
+static int64_t stack_effect(intpr::Instruction const& instruction)
+{
+	switch (instruction.type)
+	{
+	case ByteType_sINT8:
+	case ByteType_uINT8:
+	case ByteType_FLT8:
+	case BytecodeType_LOAD_LOCAL:
+	case BytecodeType_LOAD_GLOBAL:
+	case BytecodeType_LOAD_CONST:
+	case ByteType_DUP:
+		return 1;
+
+	case ByteType_DUP2:
+		return 2;
+
+	case ByteType_NEG_I: case ByteType_NEG_F:
+	case ByteType_NOT_I: case ByteType_NOT_F:
+	case BytecodeType_DEREF:
+	case BytecodeType_JUMP:
+	case BytecodeType_ADD_CONST_I:
+	case BytecodeType_INC_LOCAL:
+	case BytecodeType_INC_GLOBAL:
+		return 0;
+
+	case ByteType_ADD_I: case ByteType_ADD_F: case ByteType_ADD_S:
+	case ByteType_SUB_I: case ByteType_SUB_F:
+	case ByteType_MUL_I: case ByteType_MUL_F:
+	case ByteType_DIV_I: case ByteType_DIV_F:
+	case ByteType_MOD:
+	case ByteType_LT_I: case ByteType_LT_F: case ByteType_LT_S:
+	case ByteType_LE_I: case ByteType_LE_F: case ByteType_LE_S:
+	case ByteType_GT_I: case ByteType_GT_F: case ByteType_GT_S:
+	case ByteType_GE_I: case ByteType_GE_F: case ByteType_GE_S:
+	case ByteType_EQ_I: case ByteType_EQ_F: case ByteType_EQ_S:
+	case ByteType_NE_I: case ByteType_NE_F: case ByteType_NE_S:
+	case BytecodeType_INDEX_S:
+	case BytecodeType_INDEX_S_UNCHECKED:
+	case BytecodeType_INDEX_A:
+	case BytecodeType_INDEX_A_REF:
+	case BytecodeType_INDEX_A_I8: case BytecodeType_INDEX_A_U8:
+	case BytecodeType_INDEX_A_I16: case BytecodeType_INDEX_A_U16:
+	case BytecodeType_INDEX_A_I32: case BytecodeType_INDEX_A_U32:
+	case BytecodeType_POP:
+	case BytecodeType_STORE_LOCAL:
+	case BytecodeType_STORE_GLOBAL:
+	case ByteType_STORE_INPLACE:
+	case BytecodeType_JUMP_IF_FALSE:
+		return -1;
+
+	// The return value or arguments, if any, are removed from the stack, but no
+	// instruction follows RETURN or TAIL_CALL.
+	case BytecodeType_RETURN:
+	case BytecodeType_TAIL_CALL:
+		return 0;
+
+	case BytecodeType_STORE_INDEX_A_8:
+	case BytecodeType_STORE_INDEX_A_16:
+	case BytecodeType_STORE_INDEX_A_32:
+	case BytecodeType_LT_I_JUMP_IF_FALSE: case BytecodeType_LE_I_JUMP_IF_FALSE:
+	case BytecodeType_GT_I_JUMP_IF_FALSE: case BytecodeType_GE_I_JUMP_IF_FALSE:
+	case BytecodeType_EQ_I_JUMP_IF_FALSE: case BytecodeType_NE_I_JUMP_IF_FALSE:
+		return -2;
+
+	case BytecodeType_ALLOCATE_STR:
+		return 1 - (int64_t)instruction.operand.ui;
+
+	// The element size is also removed from the stack
+	case BytecodeType_ALLOCATE_ARR:
+	case BytecodeType_ALLOCATE_ARR_AND_FILL:
+		return -(int64_t)instruction.operand.ui;
+
+	case BytecodeType_CALL: {
+		night::id_t id = instruction.operand.ui;
+
+		if (id <= PredefinedFunctions::PRINT_STR)
+			return -1;
+		if (id == PredefinedFunctions::INPUT)
+			return 1;
+		if (id < PREDEFINED_FUNCTIONS_COUNT)
+			return 0;
+
+		InterpreterFunction const& func = InterpreterScope::funcs.at(id);
+		return (func.returns_value ? 1 : 0) - (int64_t)func.param_ids.size();
+	}
+
+	default:
+		throw debug::unhandled_case(night::to_str(instruction.type));
+	}
+}
+
+std::size_t intpr::max_stack_size(instructions_t const& instructions)
+{
+	// Number of values on the stack before each instruction, or -1 if the
+	// instruction has not been reached yet. Instructions are reached by
+	// following every jump from the first instruction.
+	std::vector<int64_t> sizes(instructions.size() + 1, -1);
+	std::vector<std::size_t> reached = { 0 };
+	sizes[0] = 0;
+
+	int64_t max_size = 0;
+
+	auto reach = [&](std::size_t index, int64_t size) {
+		assert(sizes[index] == -1 || sizes[index] == size);
+
+		if (sizes[index] == -1)
+		{
+			sizes[index] = size;
+			reached.push_back(index);
+		}
+	};
+
+	while (!reached.empty())
+	{
+		std::size_t index = reached.back();
+		reached.pop_back();
+
+		if (index == instructions.size())
+			continue;
+
+		Instruction const& instruction = instructions[index];
+		int64_t size = sizes[index] + stack_effect(instruction);
+
+		assert(size >= 0);
+		max_size = std::max(max_size, size);
+
+		switch (instruction.type)
+		{
+		case BytecodeType_RETURN:
+		case BytecodeType_TAIL_CALL:
+			break;
+		case BytecodeType_JUMP:
+			reach(instruction.operand.ui, size);
+			break;
+		default:
+			if (is_jump(instruction.type))
+				reach(instruction.operand.ui, size);
+
+			reach(index + 1, size);
+			break;
+		}
+	}
+
+	return (std::size_t)max_size;
+}
@@ -1,14 +1,23 @@
 #include "interpreter/interpreter.hpp"
 #include "interpreter/interpreter_scope.hpp"
+#include "interpreter/heap.hpp"
+#include "interpreter/input.hpp"
+#include "interpreter/output.hpp"
+#include "interpreter/format.hpp"
 #include "common/error.hpp"
 #include "common/debug.hpp"
 #include "language.hpp"
 
 #include <iostream>
+#include <charconv>
+#include <string>
 #include <cmath>
 #include <stack>
 #include <optional>
 #include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
 #include <assert.h>
 
 #include <stdio.h>
@@ -19,447 +28,637 @@
 #include <limits.h>
 #include <inttypes.h> // PRId64
 
+/*
+ * Pushes a value onto the Interpreter's stack. The stack never overflows, as
+ * each call checks it has enough room for its maximum stack size before it is
+ * interpreted, so the check here is only for debugging.
+ */
+#define stack_push(val) {							\
+	assert(sp < stack_end);							\
+	*sp++ = intpr::Value(val);						\
+}
+
 #define interpret_unary_operator(pop_as, equ) {		\
-	auto s1 = pop(s, scope).as.pop_as;				\
-	s.emplace(equ);									\
+	auto s1 = pop(sp).as.pop_as;					\
+	stack_push(equ);								\
 }
 
 #define interpret_binary_operator(pop_as, equ) {	\
-	auto s1 = pop(s, scope).as.pop_as;				\
-	auto s2 = pop(s, scope).as.pop_as;				\
-	s.emplace(equ);									\
+	auto s1 = pop(sp).as.pop_as;					\
+	auto s2 = pop(sp).as.pop_as;					\
+	stack_push(equ);								\
 }
 
-static int64_t str_to_int(char* s)
+// Compares the integers like interpret_binary_operator, and jumps if the
+// comparison is false.
+#define interpret_compare_jump(equ) {				\
+	auto s1 = pop(sp).as.i;							\
+	auto s2 = pop(sp).as.i;							\
+	if (!(equ))										\
+	{												\
+		ip = begin + ip->operand.ui;				\
+		dispatch_jump();							\
+	}												\
+}
+
+/*
+ * The interpreter loop is written with the following macros, so the same loop
+ * can be compiled with either dispatch mode. The dispatch mode is chosen with
+ * the CMake option NIGHT_DISPATCH.
+ * 
+ * Switch
+ *   A loop around a single switch statement. This is portable, but every
+ *   bytecode is dispatched from the same indirect branch at the top of the
+ *   switch, which the CPU struggles to predict.
+ * 
+ * Computed goto (NIGHT_COMPUTED_GOTO)
+ *   Every bytecode ends by jumping directly to the label of the next bytecode,
+ *   using a table of label addresses (labels as values, supported by GCC and
+ *   Clang). Each bytecode has its own indirect branch, so the CPU can learn
+ *   common bytecode sequences, such as the body of a hot loop.
+ * 
+ * dispatch_next() moves on to the next instruction, while dispatch_jump()
+ * moves on to the instruction the instruction pointer has already been set to.
+ */
+#ifdef NIGHT_COMPUTED_GOTO
+
+#define dispatch_label(type) dispatch_label_##type
+#define set_dispatch_label(type) dispatch_table[type] = &&dispatch_label(type)
+
+#define dispatch_jump() {							\
+	if (ip == end)									\
+		goto dispatch_label(end);					\
+	goto *dispatch_table[ip->type];					\
+}
+
+#define dispatch_loop_begin dispatch_jump();
+#define dispatch_loop_end dispatch_label(end):
+#define dispatch_case(type) dispatch_label(type)
+#define dispatch_default dispatch_label(default)
+#define dispatch_next() { ++ip; dispatch_jump(); }
+
+#else
+
+#define dispatch_loop_begin							\
+	while (ip != end)								\
+	{												\
+		switch (ip->type)							\
+		{
+
+#define dispatch_loop_end							\
+		}											\
+		++ip;										\
+	}
+
+#define dispatch_case(type) case type
+#define dispatch_default default
+#define dispatch_next() break
+#define dispatch_jump() continue
+
+#endif
+
+/*
+ * Parses a whole string as a number of type T, raising a runtime error if it
+ * is not a number or does not fit in T. A leading '+' is allowed, like in
+ * integer and float literals.
+ * 
+ * @param type_name Night type of T, used in the error message.
+ */
+template <typename T>
+static T str_to_num(char* s, char const* type_name)
 {
 	assert(s);
 
-	errno = 0;
-	char* temp;
-	int64_t val = strtoll(s, &temp, 10);
+	char const* data = intpr::str_data(s);
+	char const* end = data + intpr::str_len(s);
+	char const* begin = data;
+
+	if (begin != end && *begin == '+' && (begin + 1 == end || begin[1] != '-'))
+		++begin;
+
+	T num;
+	auto result = std::from_chars(begin, end, num);
 
-	if (temp == s || *temp != '\0' ||
-		((val == LLONG_MIN || val == LLONG_MAX) && errno == ERANGE))
-		fprintf(stderr, "Could not convert '%s' to long long and leftover string is: '%s'\n", s, temp);
+	if (result.ec == std::errc::result_out_of_range)
+		throw night::error::get().create_runtime_error(
+			"String '" + std::string(data, end) + "' is out of range of " + type_name + ".");
 
-	return val;
+	if (result.ec != std::errc() || result.ptr != end)
+		throw night::error::get().create_runtime_error(
+			"Could not convert string '" + std::string(data, end) + "' to " + type_name + ".");
+
+	return num;
 }
 
-static uint64_t str_to_uint(char* s)
+/*
+ * Compares two strings like strcmp(), without scanning for their ends.
+ */
+static int str_compare(char* s1, char* s2)
 {
-	assert(s);
+	s1 = intpr::str_data(s1);
+	s2 = intpr::str_data(s2);
 
-	errno = 0;
-	char* temp;
-	uint64_t val = strtoull(s, &temp, 10);
+	std::size_t s1_len = intpr::str_len(s1);
+	std::size_t s2_len = intpr::str_len(s2);
 
-	if (temp == s || *temp != '\0' ||
-		(val == ULLONG_MAX && errno == ERANGE))
-		fprintf(stderr, "Error: Could not convert '%s' to uint64_t. Leftover string: '%s'. "
-			"Value is %llu and errno is %d.\n", s, temp, val, errno);
+	if (int cmp = memcmp(s1, s2, std::min(s1_len, s2_len)))
+		return cmp;
 
-	return val;
+	return (s1_len > s2_len) - (s1_len < s2_len);
 }
 
-static float str_to_float(char* s)
+static bool str_equals(char* s1, char* s2)
 {
-	assert(s);
+	// Equal string literals are the same interned string
+	if (s1 == s2)
+		return true;
+
+	std::size_t len = intpr::str_len(s1);
+	return len == intpr::str_len(s2) && !memcmp(intpr::str_data(s1), intpr::str_data(s2), len);
+}
+
+/*
+ * Strings are never modified, so every single character string is created
+ * once, outside of the heap.
+ */
+static char* char_to_str(char c)
+{
+	struct CharString {
+		intpr::String header;
+		char s[2];
+	};
 
-	errno = 0;
-	char* temp;
-	float val = strtod(s, &temp);
+	static_assert(offsetof(CharString, s) == sizeof(intpr::String));
 
-	if (temp == s || *temp != '\0' ||
-		((val == FLT_MIN || val == FLT_MAX) && errno == ERANGE))
-		fprintf(stderr, "Could not convert '%s' to float and leftover string is: '%s'\n", s, temp);
+	static CharString* const strs = [] {
+		static CharString strs[256];
+		for (int i = 0; i < 256; ++i)
+			strs[i] = { { 1, false }, { (char)i, '\0' } };
 
-	return val;
+		return strs;
+	}();
+
+	return strs[(unsigned char)c].s;
 }
 
-static char* char_to_str(char c)
+static void print_int(int64_t i)
 {
-	char* s = (char*)malloc(2 * sizeof(char));
-	s[0] = c;
-	s[1] = '\0';
+	char* buf = intpr::Output::reserve(intpr::max_int_length);
+	intpr::Output::commit(intpr::format_int(buf, i));
+}
 
-	return s;
+static void print_uint(uint64_t ui)
+{
+	char* buf = intpr::Output::reserve(intpr::max_int_length);
+	intpr::Output::commit(intpr::format_uint(buf, ui));
 }
 
-static char* int_to_str(int64_t i)
+static void print_float(double d)
 {
-	// A 64-bit integer can have up to 19 digits + sign + null terminator
-	char* s = (char*)malloc(21 * sizeof(char));
-	if (!s)
-		return nullptr;
+	char* buf = intpr::Output::reserve(intpr::max_float_length + 1);
+	std::size_t length = intpr::format_float(buf, d);
 
-	snprintf(s, 21, "%" PRId64, i);
-	return s;
+	// Floats are printed with a suffix
+	buf[length] = 'f';
+	intpr::Output::commit(length + 1);
 }
 
-static char* uint_to_str(uint64_t i)
+/*
+ * Copies a formatted number into a heap string of its exact length.
+ */
+static char* copy_to_str(char const* buf, std::size_t len)
 {
-	// A 64-bit unsigned integer can have up to 20 digits + null terminator
-	char* s = (char*)malloc(21 * sizeof(char));
-	if (!s)
-		return nullptr;
+	char* s = intpr::Heap::allocate_str(len);
+	memcpy(s, buf, len);
 
-	snprintf(s, 21, "%" PRIu64, i);
 	return s;
 }
 
-static char* float_to_str(float f)
+static char* int_to_str(int64_t i)
 {
-	int size = 65;
-	char* s = (char*)malloc(size);
+	char buf[intpr::max_int_length];
+	return copy_to_str(buf, intpr::format_int(buf, i));
+}
 
-	snprintf(s, size, "%f", f);
-	return s;
+static char* uint_to_str(uint64_t i)
+{
+	char buf[intpr::max_int_length];
+	return copy_to_str(buf, intpr::format_uint(buf, i));
 }
 
-std::optional<intpr::Value> interpret_bytecodes(InterpreterScope& scope, bytecodes_t const& codes, bool is_global, char* buf)
+static char* float_to_str(float f)
 {
-	if (!InterpreterScope::global_scope)
-		InterpreterScope::global_scope = &scope;
+	char buf[intpr::max_fixed_length];
+	return copy_to_str(buf, intpr::format_fixed(buf, f));
+}
 
-	// Disable stdout buffering
-	setbuf(stdout, NULL);
+/*
+ * The Interpreter's stack, a single contiguous block shared by all function
+ * calls. Each call places its variables on top of its caller's stack, followed
+ * by its own values, so calls do not allocate anything.
+ */
+static std::vector<intpr::Value> stack;
+static intpr::Value* stack_end = nullptr;
 
-	std::stack<intpr::Value> s;
+std::optional<intpr::Value> interpret_bytecodes(InterpreterScope& scope, intpr::instructions_t const& instructions, bool is_global, intpr::OutputSink* out)
+{
+	if (is_global)
+		InterpreterScope::global_scope = &scope;
+
+	intpr::Output::set_sink(out);
 
-	// This freeze is for while loop bytecode.
-	// The last JUMP in While loop bytecode jumps to before the start of the vector.
-	// But you can not have an iterator point to before the start of a vector. So
-	// the iterator will jump to the first element, and stay there instead of being
-	// incremented by the for loop.
-	bool freeze = false;
+	// Printed output is written once the program ends, even if it ends with
+	// an error, and the sink, which may not outlive the call, is reset
+	struct FlushOutput {
+		~FlushOutput() { intpr::Output::set_sink(NULL); }
+	} flush_output;
 
-	for (auto it = std::begin(codes); it != std::end(codes); ++it)
+	if (stack.empty())
 	{
-		if (freeze)
-		{
-			--it;
-			freeze = false;
-		}
+		stack.resize(intpr::stack_capacity);
+		stack_end = stack.data() + stack.size();
+	}
 
-		switch (*it)
-		{
-		case ByteType_sINT1: s.emplace(interpret_int<int64_t>(it, 1)); break;
-		case ByteType_sINT2: s.emplace(interpret_int<int64_t>(it, 2)); break;
-		case ByteType_sINT4: s.emplace(interpret_int<int64_t>(it, 4)); break;
-		case ByteType_sINT8: s.emplace(interpret_int<int64_t>(it, 8)); break;
-
-		case ByteType_uINT1: s.emplace(interpret_int<uint64_t>(it, 1)); break;
-		case ByteType_uINT2: s.emplace(interpret_int<uint64_t>(it, 2)); break;
-		case ByteType_uINT4: s.emplace(interpret_int<uint64_t>(it, 4)); break;
-		case ByteType_uINT8: s.emplace(interpret_int<uint64_t>(it, 8)); break;
-
-		case ByteType_FLT4: s.emplace(interpret_flt(it, 4)); break;
-		case ByteType_FLT8: s.emplace(interpret_flt(it, 8)); break;
-
-		case ByteType_NEG_I: interpret_unary_operator(i, -s1); break;
-		case ByteType_NEG_F: interpret_unary_operator(d, -s1); break;
-
-		case ByteType_NOT_I: interpret_unary_operator(i, int64_t(!s1)); break;
-		case ByteType_NOT_F: interpret_unary_operator(d, int64_t(!s1)); break;
-
-		case ByteType_ADD_I: interpret_binary_operator(i, s1 + s2); break;
-		case ByteType_ADD_F: interpret_binary_operator(d, s1 + s2); break;
-		case ByteType_ADD_S: {
-			auto s1 = pop(s, scope).as.s;
-			auto s2 = pop(s, scope).as.s;
-
-			size_t s1_len = strlen(s1);
-			size_t s2_len = strlen(s2);
-			size_t len = s1_len + s2_len + 1;
-			char* result = (char*)malloc(sizeof(char) * len);
-			if (!result)
-				exit(1);
-
-			strncpy(result, s2, len);
-			result[len - 1] = '\0';
-			strncat(result, s1, len - s2_len - 1);
-
-			s.emplace(result);
-			break;
-		}
+	if (intpr::max_stack_size(instructions) > stack.size())
+		throw night::error::get().create_runtime_error("Stack overflow.");
 
-		case ByteType_SUB_I: interpret_binary_operator(i, s2 - s1); break;
-		case ByteType_SUB_F: interpret_binary_operator(d, s2 - s1); break;
+	intpr::Value* sp = stack.data();
 
-		case ByteType_MUL_I: interpret_binary_operator(i, s1 * s2); break;
-		case ByteType_MUL_F: interpret_binary_operator(d, s1 * s2); break;
+	// Variables of the function being interpreted, followed by the start of its
+	// values. Global variables are in the global scope instead.
+	intpr::Value* bp = sp;
+	intpr::Value* base = sp;
 
-		case ByteType_DIV_I: interpret_binary_operator(i, s2 / s1); break; 
-		case ByteType_DIV_F: interpret_binary_operator(d, s2 / s1); break;
-		case ByteType_MOD:   interpret_binary_operator(i, s2 % s1); break;
+	// Callers of the function being interpreted.
+	std::vector<intpr::CallFrame> frames;
 
-		// stack values are in opposite order, so we switch signs to account for that
-		case ByteType_LT_I: interpret_binary_operator(i, int64_t(s1 > s2));				break;
-		case ByteType_LT_F: interpret_binary_operator(d, int64_t(s1 > s2));				break;
-		case ByteType_LT_S: interpret_binary_operator(s, int64_t(strcmp(s1, s2) > 0));	break;
+#ifdef NIGHT_COMPUTED_GOTO
+	static void* dispatch_table[256];
+	static bool is_dispatch_table_set = false;
 
-		case ByteType_LE_I: interpret_binary_operator(i, int64_t(s1 >= s2));			break;
-		case ByteType_LE_F: interpret_binary_operator(d, int64_t(s1 >= s2));			break;
-		case ByteType_LE_S: interpret_binary_operator(s, int64_t(strcmp(s1, s2) >= 0));	break;
+	if (!is_dispatch_table_set)
+	{
+		for (void*& label : dispatch_table)
+			label = &&dispatch_label(default);
+
+		set_dispatch_label(ByteType_sINT8); set_dispatch_label(ByteType_uINT8);
+		set_dispatch_label(ByteType_FLT8);
+
+		set_dispatch_label(ByteType_NEG_I); set_dispatch_label(ByteType_NEG_F);
+		set_dispatch_label(ByteType_NOT_I); set_dispatch_label(ByteType_NOT_F);
+
+		set_dispatch_label(ByteType_ADD_I); set_dispatch_label(ByteType_ADD_F); set_dispatch_label(ByteType_ADD_S);
+		set_dispatch_label(ByteType_SUB_I); set_dispatch_label(ByteType_SUB_F);
+		set_dispatch_label(ByteType_MUL_I); set_dispatch_label(ByteType_MUL_F);
+		set_dispatch_label(ByteType_DIV_I); set_dispatch_label(ByteType_DIV_F);
+		set_dispatch_label(ByteType_MOD);
+
+		set_dispatch_label(ByteType_LT_I); set_dispatch_label(ByteType_LT_F); set_dispatch_label(ByteType_LT_S);
+		set_dispatch_label(ByteType_LE_I); set_dispatch_label(ByteType_LE_F); set_dispatch_label(ByteType_LE_S);
+		set_dispatch_label(ByteType_GT_I); set_dispatch_label(ByteType_GT_F); set_dispatch_label(ByteType_GT_S);
+		set_dispatch_label(ByteType_GE_I); set_dispatch_label(ByteType_GE_F); set_dispatch_label(ByteType_GE_S);
+		set_dispatch_label(ByteType_EQ_I); set_dispatch_label(ByteType_EQ_F); set_dispatch_label(ByteType_EQ_S);
+		set_dispatch_label(ByteType_NE_I); set_dispatch_label(ByteType_NE_F); set_dispatch_label(ByteType_NE_S);
+
+		set_dispatch_label(BytecodeType_INDEX_S); set_dispatch_label(BytecodeType_INDEX_S_UNCHECKED);
+		set_dispatch_label(BytecodeType_INDEX_A);
+		set_dispatch_label(BytecodeType_INDEX_A_REF);
+		set_dispatch_label(BytecodeType_INDEX_A_I8); set_dispatch_label(BytecodeType_INDEX_A_U8);
+		set_dispatch_label(BytecodeType_INDEX_A_I16); set_dispatch_label(BytecodeType_INDEX_A_U16);
+		set_dispatch_label(BytecodeType_INDEX_A_I32); set_dispatch_label(BytecodeType_INDEX_A_U32);
+
+		set_dispatch_label(BytecodeType_LOAD_LOCAL); set_dispatch_label(BytecodeType_LOAD_GLOBAL);
+		set_dispatch_label(BytecodeType_LOAD_CONST);
+		set_dispatch_label(ByteType_DUP); set_dispatch_label(ByteType_DUP2);
+		set_dispatch_label(BytecodeType_DEREF);
+		set_dispatch_label(BytecodeType_POP);
+		set_dispatch_label(BytecodeType_STORE_LOCAL); set_dispatch_label(BytecodeType_STORE_GLOBAL);
+		set_dispatch_label(ByteType_STORE_INPLACE);
+		set_dispatch_label(BytecodeType_STORE_INDEX_A_8); set_dispatch_label(BytecodeType_STORE_INDEX_A_16);
+		set_dispatch_label(BytecodeType_STORE_INDEX_A_32);
+
+		set_dispatch_label(BytecodeType_ALLOCATE_STR); set_dispatch_label(BytecodeType_ALLOCATE_ARR);
+		set_dispatch_label(BytecodeType_ALLOCATE_ARR_AND_FILL);
+
+		set_dispatch_label(BytecodeType_JUMP); set_dispatch_label(BytecodeType_JUMP_IF_FALSE);
+
+		set_dispatch_label(BytecodeType_RETURN); set_dispatch_label(BytecodeType_CALL);
+		set_dispatch_label(BytecodeType_TAIL_CALL);
+
+		set_dispatch_label(BytecodeType_ADD_CONST_I);
+		set_dispatch_label(BytecodeType_INC_LOCAL); set_dispatch_label(BytecodeType_INC_GLOBAL);
+		set_dispatch_label(BytecodeType_LT_I_JUMP_IF_FALSE); set_dispatch_label(BytecodeType_LE_I_JUMP_IF_FALSE);
+		set_dispatch_label(BytecodeType_GT_I_JUMP_IF_FALSE); set_dispatch_label(BytecodeType_GE_I_JUMP_IF_FALSE);
+		set_dispatch_label(BytecodeType_EQ_I_JUMP_IF_FALSE); set_dispatch_label(BytecodeType_NE_I_JUMP_IF_FALSE);
+
+		is_dispatch_table_set = true;
+	}
+#endif
+
+	// The instruction pointer is incremented by dispatch_next(). Jumps instead
+	// set the instruction pointer directly to their target.
+	intpr::Instruction const* begin = instructions.data();
+	intpr::Instruction const* end = begin + instructions.size();
+	intpr::Instruction const* ip = begin;
+
+	dispatch_loop_begin
+		// Integers and floats of all sizes are decoded into their widest type.
+		dispatch_case(ByteType_sINT8): stack_push(ip->operand.i); dispatch_next();
+		dispatch_case(ByteType_uINT8): stack_push(ip->operand.ui); dispatch_next();
+		dispatch_case(ByteType_FLT8): stack_push(ip->operand.d); dispatch_next();
+
+		dispatch_case(ByteType_NEG_I): interpret_unary_operator(i, -s1); dispatch_next();
+		dispatch_case(ByteType_NEG_F): interpret_unary_operator(d, -s1); dispatch_next();
+
+		dispatch_case(ByteType_NOT_I): interpret_unary_operator(i, int64_t(!s1)); dispatch_next();
+		dispatch_case(ByteType_NOT_F): interpret_unary_operator(d, int64_t(!s1)); dispatch_next();
+
+		dispatch_case(ByteType_ADD_I): interpret_binary_operator(i, s1 + s2); dispatch_next();
+		dispatch_case(ByteType_ADD_F): interpret_binary_operator(d, s1 + s2); dispatch_next();
+		dispatch_case(ByteType_ADD_S): {
+			auto s1 = pop(sp).as.s;
+			auto s2 = pop(sp).as.s;
+
+			stack_push(intpr::Heap::concat(s2, s1));
+			dispatch_next();
+		}
 
-		case ByteType_GT_I: interpret_binary_operator(i, int64_t(s1 < s2));				break;
-		case ByteType_GT_F: interpret_binary_operator(d, int64_t(s1 < s2));				break;
-		case ByteType_GT_S: interpret_binary_operator(s, int64_t(strcmp(s1, s2) < 0));	break;
+		dispatch_case(ByteType_SUB_I): interpret_binary_operator(i, s2 - s1); dispatch_next();
+		dispatch_case(ByteType_SUB_F): interpret_binary_operator(d, s2 - s1); dispatch_next();
 
-		case ByteType_GE_I: interpret_binary_operator(i, int64_t(s1 <= s2));			break;
-		case ByteType_GE_F: interpret_binary_operator(d, int64_t(s1 <= s2));			break;
-		case ByteType_GE_S: interpret_binary_operator(s, int64_t(strcmp(s1, s2) <= 0));	break;
+		dispatch_case(ByteType_MUL_I): interpret_binary_operator(i, s1 * s2); dispatch_next();
+		dispatch_case(ByteType_MUL_F): interpret_binary_operator(d, s1 * s2); dispatch_next();
 
-		case ByteType_EQ_I: interpret_binary_operator(i, int64_t(s1 == s2));			break;
-		case ByteType_EQ_F: interpret_binary_operator(d, int64_t(s1 == s2));			break;
-		case ByteType_EQ_S: interpret_binary_operator(s, int64_t(!strcmp(s1, s2)));		break;
+		dispatch_case(ByteType_DIV_I): interpret_binary_operator(i, s2 / s1); dispatch_next(); 
+		dispatch_case(ByteType_DIV_F): interpret_binary_operator(d, s2 / s1); dispatch_next();
+		dispatch_case(ByteType_MOD):   interpret_binary_operator(i, s2 % s1); dispatch_next();
 
-		case ByteType_NE_I: interpret_binary_operator(i, int64_t(s1 != s2));			break;
-		case ByteType_NE_F: interpret_binary_operator(d, int64_t(s1 != s2));			break;
-		case ByteType_NE_S: interpret_binary_operator(s, int64_t(strcmp(s1, s2)));		break;
+		// stack values are in opposite order, so we switch signs to account for that
+		dispatch_case(ByteType_LT_I): interpret_binary_operator(i, int64_t(s1 > s2));				dispatch_next();
+		dispatch_case(ByteType_LT_F): interpret_binary_operator(d, int64_t(s1 > s2));				dispatch_next();
+		dispatch_case(ByteType_LT_S): interpret_binary_operator(s, int64_t(str_compare(s1, s2) > 0));dispatch_next();
+
+		dispatch_case(ByteType_LE_I): interpret_binary_operator(i, int64_t(s1 >= s2));			dispatch_next();
+		dispatch_case(ByteType_LE_F): interpret_binary_operator(d, int64_t(s1 >= s2));			dispatch_next();
+		dispatch_case(ByteType_LE_S): interpret_binary_operator(s, int64_t(str_compare(s1, s2) >= 0));dispatch_next();
+
+		dispatch_case(ByteType_GT_I): interpret_binary_operator(i, int64_t(s1 < s2));				dispatch_next();
+		dispatch_case(ByteType_GT_F): interpret_binary_operator(d, int64_t(s1 < s2));				dispatch_next();
+		dispatch_case(ByteType_GT_S): interpret_binary_operator(s, int64_t(str_compare(s1, s2) < 0));dispatch_next();
+
+		dispatch_case(ByteType_GE_I): interpret_binary_operator(i, int64_t(s1 <= s2));			dispatch_next();
+		dispatch_case(ByteType_GE_F): interpret_binary_operator(d, int64_t(s1 <= s2));			dispatch_next();
+		dispatch_case(ByteType_GE_S): interpret_binary_operator(s, int64_t(str_compare(s1, s2) <= 0));dispatch_next();
+
+		dispatch_case(ByteType_EQ_I): interpret_binary_operator(i, int64_t(s1 == s2));			dispatch_next();
+		dispatch_case(ByteType_EQ_F): interpret_binary_operator(d, int64_t(s1 == s2));			dispatch_next();
+		dispatch_case(ByteType_EQ_S): interpret_binary_operator(s, int64_t(str_equals(s1, s2)));	dispatch_next();
+
+		dispatch_case(ByteType_NE_I): interpret_binary_operator(i, int64_t(s1 != s2));			dispatch_next();
+		dispatch_case(ByteType_NE_F): interpret_binary_operator(d, int64_t(s1 != s2));			dispatch_next();
+		dispatch_case(ByteType_NE_S): interpret_binary_operator(s, int64_t(!str_equals(s1, s2)));	dispatch_next();
+
+		dispatch_case(BytecodeType_INDEX_S): push_subscript(sp, true); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A): push_subscript(sp, false); dispatch_next();
+
+		dispatch_case(BytecodeType_INDEX_S_UNCHECKED): {
+			char* s = pop(sp).as.s;
+			int64_t index = pop(sp).as.i;
+			stack_push((int64_t)intpr::str_data(s)[index]);
+			dispatch_next();
+		}
 
-		case BytecodeType_AND: interpret_binary_operator(i, int64_t(s1 && s2));			break;
-		case BytecodeType_OR: interpret_binary_operator(i, int64_t(s1 || s2));			break;
+		dispatch_case(BytecodeType_INDEX_A_REF): {
+			intpr::Array* arr = pop(sp).as.a;
+			int64_t index = pop(sp).as.i;
+			check_bounds(index, arr->size);
+			stack_push(intpr::Value(&arr->data[index]));
+			dispatch_next();
+		}
 
-		case BytecodeType_INDEX_S: push_subscript(s, true, scope); break;
-		case BytecodeType_INDEX_A: push_subscript(s, false, scope); break;
+		dispatch_case(BytecodeType_INDEX_A_I8): push_elem<int8_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A_U8): push_elem<uint8_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A_I16): push_elem<int16_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A_U16): push_elem<uint16_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A_I32): push_elem<int32_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_INDEX_A_U32): push_elem<uint32_t>(sp); dispatch_next();
+
+		dispatch_case(ByteType_DUP): {
+			intpr::Value top = sp[-1];
+			stack_push(top);
+			dispatch_next();
+		}
 
+		dispatch_case(ByteType_DUP2): {
+			intpr::Value second = sp[-2];
+			intpr::Value top = sp[-1];
+			stack_push(second);
+			stack_push(top);
+			dispatch_next();
+		}
 
-		case ByteType_DUP: {
-			s.emplace(s.top());
-			break;
+		dispatch_case(BytecodeType_DEREF): {
+			sp[-1] = *sp[-1].as.var;
+			dispatch_next();
 		}
 
-		case ByteType_LOAD: {
-			night::id_t id = pop(s, scope).as.ui;
-			s.emplace(&scope.get_variable(id), true);
+		dispatch_case(BytecodeType_POP): {
+			--sp;
+			dispatch_next();
+		}
 
-			break;
+		dispatch_case(BytecodeType_LOAD_LOCAL): {
+			stack_push(bp[ip->operand.ui]);
+			dispatch_next();
 		}
 
-		case ByteType_STORE: {
-			night::id_t id = pop(s, scope).as.ui;
-			scope.set_variable(id, pop(s, scope));
+		dispatch_case(BytecodeType_LOAD_CONST): {
+			stack_push(ip->operand.ui);
+			dispatch_next();
+		}
+
+		dispatch_case(BytecodeType_LOAD_GLOBAL): {
+			stack_push(InterpreterScope::global_scope->get_variable(ip->operand.ui));
+			dispatch_next();
+		}
+
+		dispatch_case(BytecodeType_STORE_LOCAL): {
+			bp[ip->operand.ui] = pop(sp);
+			dispatch_next();
+		}
 
-			break;
+		dispatch_case(BytecodeType_STORE_GLOBAL): {
+			InterpreterScope::global_scope->set_variable(ip->operand.ui, pop(sp));
+			dispatch_next();
 		}
 		
-		case ByteType_STORE_INPLACE: {
-			intpr::Value val = pop(s, scope);
-			intpr::Value* var = pop(s, scope, true).as.var;
-			*var = val;
-			s.emplace(var, true);
-			break;
+		dispatch_case(ByteType_STORE_INPLACE): {
+			intpr::Value val = pop(sp);
+			*pop(sp).as.var = val;
+			stack_push(val);
+			dispatch_next();
 		}
 
-		case BytecodeType_LOAD_ELEM: {
-			uint64_t id = pop(s, scope).as.ui;
-			uint64_t num = pop(s, scope).as.ui;
-			intpr::Value* val = &scope.get_variable(id);
-			while (num--)
+		dispatch_case(BytecodeType_ALLOCATE_STR): push_str(sp, ip->operand.ui); dispatch_next();
+		dispatch_case(BytecodeType_ALLOCATE_ARR): push_arr(sp, ip->operand.ui); dispatch_next();
+		dispatch_case(BytecodeType_ALLOCATE_ARR_AND_FILL): push_arr_and_fill(sp, ip->operand.ui); dispatch_next();
+
+		dispatch_case(BytecodeType_STORE_INDEX_A_8): store_elem<uint8_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_STORE_INDEX_A_16): store_elem<uint16_t>(sp); dispatch_next();
+		dispatch_case(BytecodeType_STORE_INDEX_A_32): store_elem<uint32_t>(sp); dispatch_next();
+
+		dispatch_case(BytecodeType_JUMP_IF_FALSE): {
+			if (!pop(sp).as.i)
 			{
-				auto i = pop(s, scope).as.i;
-				val = &val->as.a.data[i];
+				ip = begin + ip->operand.ui;
+				dispatch_jump();
 			}
-			s.push(*val);
-			break;
+
+			dispatch_next();
 		}
 
-		case BytecodeType_ALLOCATE_STR: push_str(s, scope); break;
-		case BytecodeType_ALLOCATE_ARR: push_arr(s, scope); break;
-		case BytecodeType_ALLOCATE_ARR_AND_FILL: push_arr_and_fill(s, scope); break;
+		dispatch_case(BytecodeType_ADD_CONST_I): {
+			sp[-1].as.i += ip->operand.i;
+			dispatch_next();
+		}
 
-		case BytecodeType_STORE_INDEX_A: {
-			auto id = pop(s, scope).as.i;
-			auto expr = pop(s, scope);
-			intpr::Value* val = &scope.get_variable(id);
-			while (!s.empty())
-			{
-				auto i = pop(s, scope).as.i;
-				val = &val->as.a.data[i];
-			}
-			*val = expr;
-			break;
+		dispatch_case(BytecodeType_INC_LOCAL): {
+			bp[ip->id].as.i += ip->operand.i;
+			dispatch_next();
 		}
 
-		case BytecodeType_STORE_INDEX_S: {
-			auto id = pop(s, scope).as.i;
-			auto expr = pop(s, scope);
-			scope.get_variable(id).as.s[pop(s, scope).as.i] = (char)expr.as.i;
-			break;
+		dispatch_case(BytecodeType_INC_GLOBAL): {
+			InterpreterScope::global_scope->get_variable(ip->id).as.i += ip->operand.i;
+			dispatch_next();
 		}
 
-		case BytecodeType_JUMP_IF_FALSE: {
-			auto offset = pop(s, scope).as.i;
-			if (!pop(s, scope).as.i)
-				std::advance(it, offset);
-			break;
+		dispatch_case(BytecodeType_LT_I_JUMP_IF_FALSE): interpret_compare_jump(s1 > s2); dispatch_next();
+		dispatch_case(BytecodeType_LE_I_JUMP_IF_FALSE): interpret_compare_jump(s1 >= s2); dispatch_next();
+		dispatch_case(BytecodeType_GT_I_JUMP_IF_FALSE): interpret_compare_jump(s1 < s2); dispatch_next();
+		dispatch_case(BytecodeType_GE_I_JUMP_IF_FALSE): interpret_compare_jump(s1 <= s2); dispatch_next();
+		dispatch_case(BytecodeType_EQ_I_JUMP_IF_FALSE): interpret_compare_jump(s1 == s2); dispatch_next();
+		dispatch_case(BytecodeType_NE_I_JUMP_IF_FALSE): interpret_compare_jump(s1 != s2); dispatch_next();
+
+		dispatch_case(BytecodeType_JUMP):
+			// Every loop jumps back, so garbage is collected here and before
+			// calls, where no value is held outside the stack
+			intpr::Heap::collect_if_needed(stack.data(), sp);
+
+			ip = begin + ip->operand.ui;
+			dispatch_jump();
+
+		dispatch_case(BytecodeType_RETURN): {
+			std::optional<intpr::Value> rtn_value;
+			if (sp != base)
+				rtn_value = pop(sp);
+
+			if (frames.empty())
+				return rtn_value;
+
+			// The function's variables, starting with its arguments, are
+			// replaced by the return value
+			sp = bp;
+			if (rtn_value.has_value())
+				stack_push(*rtn_value);
+
+			intpr::CallFrame const& frame = frames.back();
+			ip = frame.return_ip;
+			begin = frame.begin;
+			end = frame.end;
+			bp = frame.bp;
+			base = frame.base;
+			frames.pop_back();
+
+			dispatch_next();
 		}
 
-		case BytecodeType_JUMP:
-			std::advance(it, pop(s, scope).as.i);
-			break;
-		case ByteType_JUMP_N:
-			std::advance(it, -pop(s, scope).as.i);
-			freeze = true;
-			break;
+		dispatch_case(BytecodeType_TAIL_CALL): {
+			intpr::Heap::collect_if_needed(stack.data(), sp);
+
+			InterpreterFunction const& func = InterpreterScope::funcs[ip->operand.ui];
+
+			// The arguments replace the variables of the current frame
+			std::copy(sp - func.param_ids.size(), sp, bp);
 
-		case BytecodeType_RETURN: {
-			if (s.empty())
-				return std::nullopt;
+			if (bp + func.frame_size + func.max_stack_size > stack_end)
+				throw night::error::get().create_runtime_error("Stack overflow.");
 
-			return pop(s, scope);
+			// The caller of the current function is kept, so the called function
+			// returns to it directly
+			base = bp + func.frame_size;
+			sp = base;
+
+			begin = func.instructions.data();
+			end = begin + func.instructions.size();
+			ip = begin;
+
+			dispatch_jump();
 		}
 
-		case BytecodeType_CALL: {
-			night::id_t id = pop(s, scope).as.i;
+		dispatch_case(BytecodeType_CALL): {
+			night::id_t id = ip->operand.ui;
 
 			switch (id)
 			{
-			case PredefinedFunctions::PRINT_BOOL:
-				if (!buf)
-					printf(pop(s, scope).as.i ? "true" : "false");
-				else {
-					const char* bool_str = pop(s, scope).as.i ? "true" : "false";
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len; // Assume buffer is at least 1024 bytes
-					snprintf(buf + current_len, remaining, "%s", bool_str);
-				}
-				break;
-			case PredefinedFunctions::PRINT_CHAR:
-				if (!buf)
-					printf("%c", (char)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%c", (char)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_INT8:
-				if (!buf)
-					printf("%" PRId8, (int8_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRId8, (int8_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_INT16:
-				if (!buf)
-					printf("%" PRId16, (int16_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRId16, (int16_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_INT32:
-				if (!buf)
-					printf("%" PRId32, (int32_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRId32, (int32_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_INT64:
-				if (!buf)
-					printf("%" PRId64, pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRId64, pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_uINT8:
-				if (!buf)
-					printf("%" PRIu8, (uint8_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRIu8, (uint8_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_uINT16:
-				if (!buf)
-					printf("%" PRIu16, (uint16_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRIu16, (uint16_t)pop(s, scope).as.i);
-				}
+			case PredefinedFunctions::PRINT_BOOL: {
+				char const* bool_str = pop(sp).as.i ? "true" : "false";
+				intpr::Output::write(bool_str, strlen(bool_str));
 				break;
-			case PredefinedFunctions::PRINT_uINT32:
-				if (!buf)
-					printf("%" PRIu32, (uint32_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRIu32, (uint32_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_uINT64:
-				if (!buf)
-					printf("%" PRIu64, (uint64_t)pop(s, scope).as.i);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%" PRIu64, (uint64_t)pop(s, scope).as.i);
-				}
-				break;
-			case PredefinedFunctions::PRINT_FLOAT:
-				if (!buf)
-					printf("%.17gf", pop(s, scope).as.d);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%.17gf", pop(s, scope).as.d);
-				}
+			}
+			case PredefinedFunctions::PRINT_CHAR: {
+				char c = (char)pop(sp).as.i;
+				intpr::Output::write(&c, 1);
 				break;
-			case PredefinedFunctions::PRINT_STR:
-				if (!buf)
-					printf("%s", pop(s, scope).as.s);
-				else {
-					size_t current_len = strlen(buf);
-					size_t remaining = 1024 - current_len;
-					snprintf(buf + current_len, remaining, "%s", pop(s, scope).as.s);
-				}
+			}
+			case PredefinedFunctions::PRINT_INT8: print_int((int8_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_INT16: print_int((int16_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_INT32: print_int((int32_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_INT64: print_int(pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_uINT8: print_uint((uint8_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_uINT16: print_uint((uint16_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_uINT32: print_uint((uint32_t)pop(sp).as.i); break;
+			case PredefinedFunctions::PRINT_uINT64: print_uint(pop(sp).as.ui); break;
+			case PredefinedFunctions::PRINT_FLOAT: print_float(pop(sp).as.d); break;
+			case PredefinedFunctions::PRINT_STR: {
+				char* s = pop(sp).as.s;
+				intpr::Output::write(intpr::str_data(s), intpr::str_len(s));
 				break;
+			}
 
 			case PredefinedFunctions::INPUT:
-				s.emplace(interpret_predefined_input());
+				stack_push(interpret_predefined_input());
 				break;
 
 			case PredefinedFunctions::INT8_TO_CHAR:
-				s.emplace((int64_t)(char)(int8_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(int8_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::INT16_TO_CHAR:
-				s.emplace((int64_t)(char)(int16_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(int16_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::INT32_TO_CHAR:
-				s.emplace((int64_t)(char)(int32_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(int32_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::INT64_TO_CHAR:
-				s.emplace((int64_t)(char)pop(s, scope).as.i);
+				stack_push((int64_t)(char)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::uINT8_TO_CHAR:
-				s.emplace((int64_t)(char)(uint8_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(uint8_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::uINT16_TO_CHAR:
-				s.emplace((int64_t)(char)(uint16_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(uint16_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::uINT32_TO_CHAR:
-				s.emplace((int64_t)(char)(uint32_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(uint32_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::uINT64_TO_CHAR:
-				s.emplace((int64_t)(char)(uint64_t)pop(s, scope).as.i);
+				stack_push((int64_t)(char)(uint64_t)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::STR_TO_CHAR: {
-				char* str = pop(s, scope).as.s;
-				if (strlen(str) != 1)
+				char* str = pop(sp).as.s;
+				if (intpr::str_len(str) != 1)
 					throw night::error::get().create_runtime_error("Could not convert string to char.");
 
-				s.emplace((int64_t)str[0]);
+				stack_push((int64_t)intpr::str_data(str)[0]);
 				break;
 			}
 
@@ -467,301 +666,231 @@ std::optional<intpr::Value> interpret_bytecodes(InterpreterScope& scope, bytecod
 			case PredefinedFunctions::BOOL_TO_INT16:
 			case PredefinedFunctions::BOOL_TO_INT32:
 			case PredefinedFunctions::BOOL_TO_INT64:
-				s.emplace(pop(s, scope).as.i);
+				stack_push(pop(sp).as.i);
 				break;
 			case PredefinedFunctions::BOOL_TO_uINT8:
 			case PredefinedFunctions::BOOL_TO_uINT16:
 			case PredefinedFunctions::BOOL_TO_uINT32:
 			case PredefinedFunctions::BOOL_TO_uINT64:
-				s.emplace((uint64_t)pop(s, scope).as.i);
+				stack_push((uint64_t)pop(sp).as.i);
 				break;
 
 			case PredefinedFunctions::CHAR_TO_INT8:
 			case PredefinedFunctions::CHAR_TO_INT16:
 			case PredefinedFunctions::CHAR_TO_INT32:
 			case PredefinedFunctions::CHAR_TO_INT64:
-				s.emplace(pop(s, scope).as.i);
+				stack_push(pop(sp).as.i);
 				break;
 			case PredefinedFunctions::CHAR_TO_uINT8:
 			case PredefinedFunctions::CHAR_TO_uINT16:
 			case PredefinedFunctions::CHAR_TO_uINT32:
 			case PredefinedFunctions::CHAR_TO_uINT64:
-				s.emplace((uint64_t)pop(s, scope).as.i);
+				stack_push((uint64_t)pop(sp).as.i);
 				break;
 
 			case PredefinedFunctions::FLOAT_TO_INT8:
 			case PredefinedFunctions::FLOAT_TO_INT16:
 			case PredefinedFunctions::FLOAT_TO_INT32:
 			case PredefinedFunctions::FLOAT_TO_INT64:
-				s.emplace((int64_t)pop(s, scope).as.d);
+				stack_push((int64_t)pop(sp).as.d);
 				break;
 			case PredefinedFunctions::FLOAT_TO_uINT8:
 			case PredefinedFunctions::FLOAT_TO_uINT16:
 			case PredefinedFunctions::FLOAT_TO_uINT32:
 			case PredefinedFunctions::FLOAT_TO_uINT64:
-				s.emplace((uint64_t)pop(s, scope).as.d);
+				stack_push((uint64_t)pop(sp).as.d);
 				break;
 
-			case PredefinedFunctions::STR_TO_INT8:
-			case PredefinedFunctions::STR_TO_INT16:
-			case PredefinedFunctions::STR_TO_INT32:
-			case PredefinedFunctions::STR_TO_INT64:
-				s.emplace(str_to_int(pop(s, scope).as.s));
-				break;
-			case PredefinedFunctions::STR_TO_uINT8:
-			case PredefinedFunctions::STR_TO_uINT16:
-			case PredefinedFunctions::STR_TO_uINT32:
-			case PredefinedFunctions::STR_TO_uINT64:
-				s.emplace((uint64_t)str_to_int(pop(s, scope).as.s));
-				break;
+			case PredefinedFunctions::STR_TO_INT8: stack_push((int64_t)str_to_num<int8_t>(pop(sp).as.s, "int8")); break;
+			case PredefinedFunctions::STR_TO_INT16: stack_push((int64_t)str_to_num<int16_t>(pop(sp).as.s, "int16")); break;
+			case PredefinedFunctions::STR_TO_INT32: stack_push((int64_t)str_to_num<int32_t>(pop(sp).as.s, "int32")); break;
+			case PredefinedFunctions::STR_TO_INT64: stack_push(str_to_num<int64_t>(pop(sp).as.s, "int64")); break;
+			case PredefinedFunctions::STR_TO_uINT8: stack_push((uint64_t)str_to_num<uint8_t>(pop(sp).as.s, "uint8")); break;
+			case PredefinedFunctions::STR_TO_uINT16: stack_push((uint64_t)str_to_num<uint16_t>(pop(sp).as.s, "uint16")); break;
+			case PredefinedFunctions::STR_TO_uINT32: stack_push((uint64_t)str_to_num<uint32_t>(pop(sp).as.s, "uint32")); break;
+			case PredefinedFunctions::STR_TO_uINT64: stack_push(str_to_num<uint64_t>(pop(sp).as.s, "uint64")); break;
 
 			case PredefinedFunctions::BOOL_TO_FLOAT:
-				s.emplace(pop(s, scope).as.i ? 1.0f : 0.0f);
+				stack_push(pop(sp).as.i ? 1.0f : 0.0f);
 				break;
 			case PredefinedFunctions::CHAR_TO_FLOAT:
-				s.emplace((double)pop(s, scope).as.i);
+				stack_push((double)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::INT8_TO_FLOAT:
 			case PredefinedFunctions::INT16_TO_FLOAT:
 			case PredefinedFunctions::INT32_TO_FLOAT:
 			case PredefinedFunctions::INT64_TO_FLOAT:
-				s.emplace((double)pop(s, scope).as.i);
+				stack_push((double)pop(sp).as.i);
 				break;
 			case PredefinedFunctions::uINT8_TO_FLOAT:
 			case PredefinedFunctions::uINT16_TO_FLOAT:
 			case PredefinedFunctions::uINT32_TO_FLOAT:
 			case PredefinedFunctions::uINT64_TO_FLOAT:
-				s.emplace((double)pop(s, scope).as.ui);
+				stack_push((double)pop(sp).as.ui);
 				break;
 
 			case PredefinedFunctions::STR_TO_FLOAT:
-				s.emplace(str_to_float(pop(s, scope).as.s));
+				stack_push((double)str_to_num<float>(pop(sp).as.s, "float"));
 				break;
 
 			case PredefinedFunctions::CHAR_TO_STR:
-				s.emplace(char_to_str((char)pop(s, scope).as.i));
+				stack_push(char_to_str((char)pop(sp).as.i));
 				break;
 			case PredefinedFunctions::INT8_TO_STR:
 			case PredefinedFunctions::INT16_TO_STR:
 			case PredefinedFunctions::INT32_TO_STR:
 			case PredefinedFunctions::INT64_TO_STR:
-				s.emplace(int_to_str(pop(s, scope).as.i));
+				stack_push(int_to_str(pop(sp).as.i));
 				break;
 			case PredefinedFunctions::uINT8_TO_STR:
 			case PredefinedFunctions::uINT16_TO_STR:
 			case PredefinedFunctions::uINT32_TO_STR:
 			case PredefinedFunctions::uINT64_TO_STR:
-				s.emplace(uint_to_str(pop(s, scope).as.ui));
+				stack_push(uint_to_str(pop(sp).as.ui));
 				break;
 			case PredefinedFunctions::FLOAT_TO_STR:
-				s.emplace(float_to_str((float)pop(s, scope).as.d));
+				stack_push(float_to_str((float)pop(sp).as.d));
 				break;
 
 			case PredefinedFunctions::LEN:
-				s.emplace((int64_t)strlen(pop(s, scope).as.s));
+				stack_push((int64_t)intpr::str_len(pop(sp).as.s));
 				break;
 			default: {
-				// Functions' only allowed parent scope is the global scope
-				InterpreterScope func_scope(InterpreterScope::global_scope);
+				intpr::Heap::collect_if_needed(stack.data(), sp);
 
-				for (int i = scope.funcs[id].param_ids.size() - 1; i >= 0; --i)
-					func_scope.set_variable(InterpreterScope::funcs[id].param_ids[i], pop(s, scope));
+				InterpreterFunction const& func = InterpreterScope::funcs[id];
 
-				auto rtn_value = interpret_bytecodes(func_scope, InterpreterScope::funcs[id].codes, false, buf);
-				if (rtn_value.has_value())
-					s.push(*rtn_value);
+				// The arguments on top of the stack become the function's first
+				// variables, which are the slots of its parameters
+				intpr::Value* func_bp = sp - func.param_ids.size();
 
-				break;
+				if (func_bp + func.frame_size + func.max_stack_size > stack_end)
+					throw night::error::get().create_runtime_error("Stack overflow.");
+
+				frames.push_back({ ip, begin, end, bp, base });
+
+				bp = func_bp;
+				base = bp + func.frame_size;
+				sp = base;
+
+				begin = func.instructions.data();
+				end = begin + func.instructions.size();
+				ip = begin;
+
+				dispatch_jump();
 			}
 			}
 
-			break;
+			dispatch_next();
 		}
 
-		default:
-			throw debug::unhandled_case(*it);
-		}
-	}
+		dispatch_default:
+			throw debug::unhandled_case(night::to_str(ip->type));
+
+	dispatch_loop_end
 
 	return std::nullopt;
 }
 
-double interpret_flt(bytecodes_t::const_iterator& it, unsigned short size)
+char* interpret_predefined_input()
 {
-	assert(size == 4 || size == 8);
-
-	union {
-		uint8_t bytes[sizeof(double)];
-		double d;
-		float f;
-	};
+	// Anything printed before the input, such as a prompt, is shown first
+	intpr::Output::flush();
 
-	for (unsigned short i = 0; i < size; ++i)
-		bytes[i] = *(++it);
-
-	return size == 4 ? f : d;
+	return intpr::Input::read_line();
 }
 
-char* interpret_predefined_input()
+void push_str(intpr::Value*& sp, uint64_t size)
 {
-	int size = 32;
-	char* buf = (char*)malloc(sizeof(char) * size);
-
-	if (!buf)
-		exit(1);
-
-	int c;
-	int len = 0;
-	while ((c = getchar()) != '\n' && c != EOF)
-	{
-		if (len == size - 1)
-		{
-			size *= 1.5;
-			char* new_buf = (char*)realloc(buf, sizeof(char) * size);
-
-			if (!new_buf)
-			{
-				free(buf);
-				exit(1);
-			}
-
-			buf = new_buf;
-		}
+	char* arr = intpr::Heap::allocate_str(size);
 
-		buf[len] = c;
-		++len;
-	}
+	for (uint64_t i = size; i > 0; --i)
+		arr[i - 1] = (char)pop(sp).as.i;
 
-	buf[len] = '\0';
-	return buf;
+	*sp++ = arr;
 }
 
-void push_str(std::stack<intpr::Value>& s, InterpreterScope& scope)
+void push_arr(intpr::Value*& sp, uint64_t size)
 {
-	uint64_t size = pop(s, scope).as.ui;
-	char* arr = (char*)malloc((size + 1) * sizeof(char));
+	std::size_t elem_size = pop(sp).as.ui;
+	intpr::Array* arr = intpr::Heap::allocate_arr(size, elem_size);
 
 	for (uint64_t i = size; i > 0; --i)
-		arr[i - 1] = (char)pop(s, scope).as.i;
+	{
+		intpr::Value elem = pop(sp);
 
-	arr[size] = '\0';
+		switch (elem_size)
+		{
+		case sizeof(uint8_t): ((uint8_t*)arr->data)[i - 1] = (uint8_t)elem.as.ui; break;
+		case sizeof(uint16_t): ((uint16_t*)arr->data)[i - 1] = (uint16_t)elem.as.ui; break;
+		case sizeof(uint32_t): ((uint32_t*)arr->data)[i - 1] = (uint32_t)elem.as.ui; break;
+		default: arr->data[i - 1] = elem; break;
+		}
+	}
 
-	s.push(arr);
+	*sp++ = arr;
 }
 
-void push_arr(std::stack<intpr::Value>& s, InterpreterScope& scope)
+void push_arr_and_fill(intpr::Value*& sp, uint64_t dimensions)
 {
-	uint64_t size = pop(s, scope).as.ui;
-	intpr::Value arr;
-	arr.as.a.size = size;
-	arr.as.a.data = new intpr::Value[size];
+	std::size_t elem_size = pop(sp).as.ui;
+	std::vector<std::size_t> sizes(dimensions);
 
-	for (uint64_t i = size; i > 0; --i)
-		arr.as.a.data[i - 1] = pop(s, scope);
+	for (uint64_t i = dimensions; i > 0; --i)
+		sizes[i - 1] = (std::size_t)pop(sp).as.i;
 
-	s.push(arr);
+	*sp++ = intpr::Heap::allocate_arr(sizes, elem_size);
 }
 
-void push_arr_and_fill(std::stack<intpr::Value>& s, InterpreterScope& scope)
+template <typename T>
+void push_elem(intpr::Value*& sp)
 {
-	uint64_t dimensions = pop(s, scope).as.ui;
-	std::vector<int> sizes(dimensions);
+	intpr::Array* arr = pop(sp).as.a;
+	int64_t index = pop(sp).as.i;
+	check_bounds(index, arr->size);
 
-	for (uint64_t i = dimensions; i > 0; --i)
-		sizes[i - 1] = (int)pop(s, scope).as.i;
-	
-	intpr::Value arr;
-	fill_arr(arr, s, sizes, 0);
-
-	s.push(arr);
+	// Sign extends signed elements
+	*sp++ = intpr::Value((std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>)((T const*)arr->data)[index]);
 }
 
-void fill_arr(intpr::Value& arr, std::stack<intpr::Value>& s, std::vector<int> const& dimensions, int current_dimension)
+template <typename T>
+void store_elem(intpr::Value*& sp)
 {
-	if (current_dimension < dimensions.size())
-	{
-		arr.as.a.size = dimensions[current_dimension];
-		arr.as.a.data = new intpr::Value[dimensions[current_dimension]];
+	intpr::Value val = pop(sp);
+	intpr::Array* arr = pop(sp).as.a;
+	int64_t index = pop(sp).as.i;
+	check_bounds(index, arr->size);
 
-		for (int i = 0; i < dimensions[current_dimension]; ++i)
-		{
-			intpr::Value element;
-			fill_arr(element, s, dimensions, current_dimension + 1);
-
-			arr.as.a.data[i] = element;
-		}
-	}
-	else
-	{
-		arr.as.i = 0;
-		arr.as.ui = 0;
-		arr.as.d = 0;
-	}
+	((T*)arr->data)[index] = (T)val.as.ui;
+	*sp++ = val;
 }
 
-void push_subscript(std::stack<intpr::Value>& s, bool is_string, InterpreterScope& scope)
+void push_subscript(intpr::Value*& sp, bool is_string)
 {
-	auto container = pop(s, scope, true);
-	auto index = pop(s, scope);
+	auto container = pop(sp);
+	auto index = pop(sp);
 
-	if (container.is_var)
+	if (is_string)
 	{
-		if (is_string)
-			s.emplace((int64_t)container.as.var->as.s[index.as.i]);
-		else
-			s.emplace(&container.as.var->as.a.data[index.as.i], true);
+		check_bounds(index.as.i, intpr::str_len(container.as.s));
+		*sp++ = (int64_t)intpr::str_data(container.as.s)[index.as.i];
 	}
 	else
 	{
-		if (is_string)
-			s.emplace((int64_t)container.as.s[index.as.i]);
-		else
-			s.emplace(container.as.a.data[index.as.i]);
+		check_bounds(index.as.i, container.as.a->size);
+		*sp++ = container.as.a->data[index.as.i];
 	}
 }
 
-void push_string_input(std::stack<intpr::Value>& s)
+void check_bounds(int64_t index, std::size_t size)
 {
-	int size = 32;
-	char* buf = (char*)malloc(sizeof(char) * size);
-
-	if (!buf)
-		exit(1);
-
-	int c;
-	int len = 0;
-	while ((c = getchar()) != '\n' && c != EOF)
-	{
-		if (len == size - 1)
-		{
-			size = (int)(size * 1.5);
-			char* new_buf = (char*)realloc(buf, sizeof(char) * size);
-
-			if (!new_buf)
-			{
-				free(buf);
-				exit(1);
-			}
-
-			buf = new_buf;
-		}
-
-		buf[len] = c;
-		++len;
-	}
-
-	buf[len] = '\0';
-	s.emplace(buf);
+	// Negative indices are larger than any size once unsigned
+	if ((uint64_t)index >= size) [[unlikely]]
+		throw night::error::get().create_runtime_error(
+			"Index " + std::to_string(index) + " is out of bounds for size " + std::to_string(size) + ".");
 }
 
-intpr::Value pop(std::stack<intpr::Value>& s, InterpreterScope& scope, bool want_var)
+intpr::Value pop(intpr::Value*& sp)
 {
-	assert(!s.empty());
-
-	auto val = s.top();
-	s.pop();
-
-	if (!want_var && val.is_var)
-		return *val.as.var;
-	return val;
+	return *--sp;
 }
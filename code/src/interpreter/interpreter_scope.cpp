@@ -7,93 +7,55 @@
 
 InterpreterScope* InterpreterScope::global_scope = nullptr;
 func_container InterpreterScope::funcs = {};
+std::size_t InterpreterScope::global_frame_size = 0;
+std::vector<intpr::Value> InterpreterScope::consts = {};
+std::unordered_map<std::string, char*> InterpreterScope::strs = {};
+std::unordered_map<uint64_t, const_id_t> InterpreterScope::const_ids = {};
 
-intpr::Value::Value() : is_var(false) { };
+intpr::Value::Value(int64_t _i) { as.i = _i; }
 
-intpr::Value::Value(int64_t _i) : is_var(false) { as.i = _i; }
+intpr::Value::Value(uint64_t _ui) { as.ui = _ui; }
 
-intpr::Value::Value(uint64_t _ui) : is_var(false) { as.ui = _ui; }
-
-intpr::Value::Value(double _d) : is_var(false) { as.d = _d; }
+intpr::Value::Value(double _d) { as.d = _d; }
 
 intpr::Value::Value(char* _s)
-	: is_var(false)
 {
 	assert(_s);
-
-	size_t len = strlen(_s);
-
-	as.s = (char*)malloc((len + 1) * sizeof(char));
-	if (!as.s)
-		exit(1);
-
-	strncpy(as.s, _s, len);
-	as.s[len] = '\0';
+	as.s = _s;
 }
 
-intpr::Value::Value(Array _a)
-	: is_var(false)
-{
-	as.a = _a;
-}
+intpr::Value::Value(Array* _a) { as.a = _a; }
 
-intpr::Value::Value(Value const& _v)
-	: is_var(_v.is_var)
-{
-	as = _v.as;
-}
+intpr::Value::Value(Value* _var) { as.var = _var; }
 
-intpr::Value::Value(Value* var, bool is_var)
-	: is_var(true)
-{
-	as.var = var;
-}
+InterpreterScope::InterpreterScope()
+	: vars(global_frame_size) {}
 
-intpr::Value::~Value()
+char* InterpreterScope::intern_str(std::string const& s)
 {
-	
-};
+	auto [it, is_new] = strs.try_emplace(s, nullptr);
+	if (!is_new)
+		return it->second;
 
-InterpreterScope::InterpreterScope()
-	: parent(nullptr) {}
+	// Allocated outside of the heap, so it is never collected
+	intpr::String* str = (intpr::String*)malloc(sizeof(intpr::String) + s.length() + 1);
+	if (!str)
+		exit(1);
 
-InterpreterScope::InterpreterScope(InterpreterScope* _parent)
-	: parent(_parent) {}
+	str->length = s.length();
+	str->is_concat = false;
+	memcpy(str + 1, s.c_str(), s.length() + 1);
 
-intpr::Value& InterpreterScope::get_variable(night::id_t id)
-{
-	if (vars.contains(id))
-		return vars[id];
+	it->second = (char*)(str + 1);
 
-	assert(parent);
-	return parent->get_variable(id);
+	return it->second;
 }
 
-void InterpreterScope::set_variable(night::id_t id, intpr::Value const& val)
+const_id_t InterpreterScope::add_const(intpr::Value const& val)
 {
-	if (vars.contains(id))
-	{
-		vars[id] = val;
-		return;
-	}
-
-	if (!parent || !parent->has_variable(id))
-	{
-		vars[id] = val;
-		return;
-	}
-
-	assert(parent);
-	parent->set_variable(id, val);
-}
-
-bool InterpreterScope::has_variable(night::id_t id)
-{
-	if (vars.contains(id))
-		return true;
-
-	if (!parent)
-		return false;
+	auto [it, is_new] = const_ids.try_emplace(val.as.ui, (const_id_t)consts.size());
+	if (is_new)
+		consts.push_back(val);
 
-	return parent->has_variable(id);
+	return it->second;
 }
@@ -0,0 +1,115 @@
+#include "interpreter/output.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define write_fd _write
+#else
+#include <unistd.h>
+#define write_fd ::write
+#endif
+
+void intpr::StdoutSink::write(char const* data, std::size_t length)
+{
+	fwrite(data, sizeof(char), length, stdout);
+}
+
+void intpr::StdoutSink::flush()
+{
+	fflush(stdout);
+}
+
+void intpr::MemorySink::write(char const* data, std::size_t length)
+{
+	output.append(data, length);
+}
+
+intpr::FdSink::FdSink(int _fd)
+	: fd(_fd) {}
+
+void intpr::FdSink::write(char const* data, std::size_t length)
+{
+	// Writes can be partial, such as to a full pipe
+	while (length > 0)
+	{
+		auto written = write_fd(fd, data, (unsigned)length);
+		if (written <= 0)
+			return;
+
+		data += written;
+		length -= (std::size_t)written;
+	}
+}
+
+intpr::CallbackSink::CallbackSink(callback_t const& _callback)
+	: callback(_callback) {}
+
+void intpr::CallbackSink::write(char const* data, std::size_t length)
+{
+	callback(data, length);
+}
+
+bool intpr::Output::is_line_buffered = false;
+char intpr::Output::buffer[capacity];
+std::size_t intpr::Output::size = 0;
+
+intpr::StdoutSink intpr::Output::stdout_sink;
+intpr::OutputSink* intpr::Output::sink = &stdout_sink;
+
+void intpr::Output::write(char const* data, std::size_t length)
+{
+	if (size + length > capacity)
+		flush();
+
+	// Output too large for the buffer is written directly
+	if (length > capacity)
+	{
+		sink->write(data, length);
+		sink->flush();
+		return;
+	}
+
+	memcpy(buffer + size, data, length);
+	size += length;
+
+	if (is_line_buffered && memchr(data, '\n', length))
+		flush();
+}
+
+char* intpr::Output::reserve(std::size_t length)
+{
+	assert(length <= capacity);
+
+	if (size + length > capacity)
+		flush();
+
+	return buffer + size;
+}
+
+void intpr::Output::commit(std::size_t length)
+{
+	assert(size + length <= capacity);
+
+	size += length;
+
+	if (is_line_buffered && memchr(buffer + size - length, '\n', length))
+		flush();
+}
+
+void intpr::Output::flush()
+{
+	if (size > 0)
+		sink->write(buffer, size);
+	sink->flush();
+
+	size = 0;
+}
+
+void intpr::Output::set_sink(OutputSink* _sink)
+{
+	flush();
+	sink = _sink ? _sink : &stdout_sink;
+}
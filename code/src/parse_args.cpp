@@ -1,6 +1,7 @@
 #include "parse_args.hpp"
 
 #include "common/error.hpp"
+#include "interpreter/output.hpp"
 #include "version.hpp"
 
 #include <iostream>
@@ -19,6 +20,7 @@ std::string parse_args(int argc, char* argv[])
 							 "flags:\n"
 							 "    -w           shows warnings\n"
 							 "    -d           shows debug info for compiler source code (for developers)\n"
+							 "    -l           prints output line by line, instead of buffering it\n"
 							 "options:\n"
 							 "    --help       displays this message\n"
 							 "    --version    displays the version\n\n";
@@ -74,6 +76,10 @@ std::string parse_args(int argc, char* argv[])
 		{
 			night::error::get().warning_flag = true;
 		}
+		else if (args[i] == "-l")
+		{
+			intpr::Output::is_line_buffered = true;
+		}
 		else
 		{
 			std::cout << "unknown option: " << args[i] << '\n' << more_info;
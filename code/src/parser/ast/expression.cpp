@@ -1,10 +1,13 @@
 #include "parser/ast/expression.hpp"
+#include "parser/ast/expression_operator.hpp"
 #include "parser/statement_scope.hpp"
 #include "common/bytecode.hpp"
 #include "common/type.hpp"
 #include "common/util.hpp"
 #include "common/error.hpp"
 #include "common/debug.hpp"
+#include "interpreter/interpreter_scope.hpp"
+#include "language.hpp"
 
 #include <optional>
 #include <memory>
@@ -36,8 +39,9 @@ void expr::Expression::set_guard()
 expr::Variable::Variable(
 	Location const& _loc,
 	std::string const& _name,
-	std::optional<uint64_t> const& _id)
-	: Expression(_loc, Expression::single_precedence), name(_name), id(_id) {}
+	std::optional<uint64_t> const& _id,
+	bool _is_global)
+	: Expression(_loc, Expression::single_precedence), name(_name), id(_id), is_global(_is_global) {}
 
 void expr::Variable::insert_node(
 	expr::expr_p node,
@@ -45,7 +49,7 @@ void expr::Variable::insert_node(
 {
 	assert(prev);
 
-	node->insert_node(std::make_shared<expr::Variable>(loc, name, id));
+	node->insert_node(std::make_shared<expr::Variable>(loc, name, id, is_global));
 	*prev = node;
 }
 
@@ -56,23 +60,28 @@ std::optional<Type> expr::Variable::type_check(StatementScope& scope) noexcept
 		return std::nullopt;
 
 	id = variable->id;
+	is_global = variable->is_global;
 
 	return variable->type;
 }
 
 expr::expr_p expr::Variable::optimize(StatementScope const& scope)
 {
-	return std::make_shared<Variable>(loc, name, id);
+	return std::make_shared<Variable>(loc, name, id, is_global);
 }
 
 bytecodes_t expr::Variable::generate_codes() const
 {
 	assert(id.has_value());
 
-	bytecodes_t bytes = int_to_bytes(id.value());
-	bytes.push_back(ByteType_LOAD);
+	return night::variable_to_bytes(is_global ? BytecodeType_LOAD_GLOBAL : BytecodeType_LOAD_LOCAL, id.value());
+}
 
-	return bytes;
+bytecodes_t expr::Variable::generate_store_codes() const
+{
+	assert(id.has_value());
+
+	return night::variable_to_bytes(is_global ? BytecodeType_STORE_GLOBAL : BytecodeType_STORE_LOCAL, id.value());
 }
 
 
@@ -165,7 +174,8 @@ std::optional<Type> expr::Array::type_check(StatementScope& scope) noexcept
 
 		Type element_type = *std::begin(types);
 		// Return the same primitive with one higher dimension.
-		return Type(element_type.get_prim(), element_type.get_dim() + 1);
+		type = Type(element_type.get_prim(), element_type.get_dim() + 1);
+		return type;
 	}
 }
 
@@ -179,6 +189,11 @@ expr::expr_p expr::Array::optimize(StatementScope const& scope)
 
 bytecodes_t expr::Array::generate_codes() const
 {
+	// String literals are interned, so they are created once and loaded from
+	// the constant pool
+	if (std::optional<std::string> str = get_str_literal())
+		return night::const_to_bytes(InterpreterScope::add_const(InterpreterScope::intern_str(*str)));
+
 	bytecodes_t bytes;
 
 	for (std::size_t i = 0; i < elements.size(); ++i)
@@ -187,6 +202,10 @@ bytecodes_t expr::Array::generate_codes() const
 		night::container_concat(bytes, elem_codes);
 	}
 
+	// Empty arrays have no type
+	if (!is_str())
+		night::container_concat(bytes, int_to_bytes<uint8_t>(type.has_value() ? night::arr_elem_size(*type) : sizeof(uint64_t)));
+
 	auto size_bytes = int_to_bytes<uint64_t>(elements.size());
 	night::container_concat(bytes, size_bytes);
 
@@ -200,6 +219,51 @@ bool expr::Array::is_str() const
 	return is_str_;
 }
 
+std::optional<std::string> expr::Array::get_str_literal() const
+{
+	if (!is_str())
+		return std::nullopt;
+
+	std::string str;
+	for (auto const& element : elements)
+	{
+		auto numeric = std::dynamic_pointer_cast<Numeric>(element);
+		if (!numeric)
+			return std::nullopt;
+
+		str += std::visit([](auto&& c) { return (char)c; }, numeric->val);
+	}
+
+	return str;
+}
+
+void expr::Array::set_type(Type const& _type)
+{
+	if (is_str())
+		return;
+
+	type = _type;
+
+	for (auto const& element : elements)
+		set_arr_type(element, Type(_type.get_prim(), _type.get_dim() - 1));
+}
+
+void expr::set_arr_type(expr_p const& expr, Type const& type)
+{
+	if (!type.is_arr())
+		return;
+
+	if (auto arr = std::dynamic_pointer_cast<Array>(expr))
+	{
+		arr->set_type(type);
+	}
+	else if (auto subscript = std::dynamic_pointer_cast<BinaryOp>(expr);
+			 subscript && subscript->get_type() == BinaryOpType::SUBSCRIPT)
+	{
+		set_arr_type(subscript->get_rhs(), Type(type.get_prim(), type.get_dim() + 1));
+	}
+}
+
 
 expr::Allocate::Allocate(
 	Location const& _loc,
@@ -245,6 +309,9 @@ bytecodes_t expr::Allocate::generate_codes() const
 		codes.insert(std::end(codes), std::begin(size_codes), std::end(size_codes));
 	}
 
+	// Only the arrays of the last dimension hold the elements
+	night::container_concat(codes, int_to_bytes<uint8_t>(night::arr_elem_size(Type(type, 1))));
+
 	auto dimension_bytes = int_to_bytes<uint64_t>(sizes.size());
 	codes.insert(std::end(codes), std::begin(dimension_bytes), std::end(dimension_bytes));
 	
@@ -284,35 +351,8 @@ expr::expr_p expr::Numeric::optimize(StatementScope const& scope)
 
 bytecodes_t expr::Numeric::generate_codes() const
 {
-	if (double const* d = std::get_if<double>(&val))
-	{
-		bytecodes_t bytes;
-
-		// Check if the double can be converted to a float without loss of
-		// decimal precision.
-		if (*d == static_cast<double>(static_cast<float>(*d)))
-		{
-			bytes.push_back(ByteType_FLT4);
-
-			float f = static_cast<float>(*d);
-			uint8_t* p = reinterpret_cast<uint8_t*>(&f);
-
-			bytes.insert(std::end(bytes), p, p + sizeof(float));
-		}
-		else
-		{
-			bytes.push_back(ByteType_FLT8);
-
-			uint8_t const* p = reinterpret_cast<uint8_t const*>(d);
-			bytes.insert(std::end(bytes), p, p + sizeof(double));
-		}
-
-		return bytes;
-	}
-	else
-	{
-		return int_to_bytes(std::get<int64_t>(val));
-	}
+	intpr::Value constant = std::visit([](auto&& arg) { return intpr::Value(arg); }, val);
+	return night::const_to_bytes(InterpreterScope::add_const(constant));
 }
 
 bool expr::Numeric::is_true() const
@@ -407,6 +447,9 @@ std::optional<Type> expr::FunctionCall::type_check(StatementScope& scope) noexce
 	if (night::error::get().has_minor_errors())
 		return std::nullopt;
 
+	for (std::size_t i = 0; i < arg_exprs.size(); ++i)
+		set_arr_type(arg_exprs[i], funcs_with_same_name->second.param_types[i]);
+
 	id = funcs_with_same_name->second.id;
 	return funcs_with_same_name->second.rtn_type;
 }
@@ -439,3 +482,17 @@ bytecodes_t expr::FunctionCall::generate_codes() const
 
 	return codes;
 }
+
+bytecodes_t expr::FunctionCall::generate_tail_call_codes() const
+{
+	assert(id.has_value());
+
+	auto codes = generate_codes();
+
+	if (id.value() >= PREDEFINED_FUNCTIONS_COUNT)
+		codes.back() = BytecodeType_TAIL_CALL;
+	else
+		codes.push_back(BytecodeType_RETURN);
+
+	return codes;
+}
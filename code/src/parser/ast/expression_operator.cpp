@@ -1,5 +1,6 @@
 #include "parser/ast/expression_operator.hpp"
 #include "parser/ast/expression.hpp"
+#include "interpreter/interpreter_scope.hpp"
 #include "common/util.hpp"
 #include "common/debug.hpp"
 
@@ -326,6 +327,8 @@ std::optional<Type> expr::BinaryOp::type_check_assign()
 			"The " + operator_type_to_str() + " operator can only be used on the same types.", loc);
 	}
 
+	set_arr_type(rhs, *lhs_type);
+
 	return lhs_type;
 }
 
@@ -634,21 +637,77 @@ expr::expr_p expr::BinaryOp::optimize(StatementScope const& scope)
 	return std::make_shared<BinaryOp>(*this);
 }
 
+/*
+ * Returns the STORE_INDEX_A_* of elements loaded by the bytecode type, or
+ * _INVALID_ if it does not load an element stored unboxed.
+ */
+static bytecode_t store_elem_type(bytecode_t index_type)
+{
+	switch (index_type)
+	{
+	case BytecodeType_INDEX_A_I8: case BytecodeType_INDEX_A_U8: return BytecodeType_STORE_INDEX_A_8;
+	case BytecodeType_INDEX_A_I16: case BytecodeType_INDEX_A_U16: return BytecodeType_STORE_INDEX_A_16;
+	case BytecodeType_INDEX_A_I32: case BytecodeType_INDEX_A_U32: return BytecodeType_STORE_INDEX_A_32;
+	default: return _ByteType_INVALID_;
+	}
+}
+
 bytecodes_t expr::BinaryOp::generate_codes() const
 {
 	assert(lhs && rhs);
 
+	// The value of an assignment is the variable after it is assigned
+	if (is_variable_assignment())
+	{
+		bytecodes_t bytes = generate_variable_assignment_codes();
+		night::container_concat(bytes, lhs->generate_codes());
+
+		return bytes;
+	}
+
+	if (operator_type == BinaryOpType::AND || operator_type == BinaryOpType::OR)
+		return generate_short_circuit_codes();
+
 	bytecodes_t bytes;
 
 	night::container_concat(bytes, lhs->generate_codes());
+
+	// Elements stored unboxed are assigned directly with the index and array,
+	// while other elements are assigned through a reference to them
+	bytecode_t store_byte = ByteType_STORE_INPLACE;
 	
 	switch (operator_type) {
+	case BinaryOpType::ASSIGN:
+		if (bytes.back() == BytecodeType_INDEX_A)
+		{
+			bytes.back() = BytecodeType_INDEX_A_REF;
+		}
+		else if (bytecode_t store_elem_byte = store_elem_type(bytes.back()); store_elem_byte != _ByteType_INVALID_)
+		{
+			store_byte = store_elem_byte;
+			bytes.pop_back();
+		}
+		break;
 	case BinaryOpType::ADD_ASSIGN:
 	case BinaryOpType::SUB_ASSIGN:
 	case BinaryOpType::MULT_ASSIGN:
 	case BinaryOpType::DIV_ASSIGN:
 	case BinaryOpType::MOD_ASSIGN:
-		bytes.push_back(ByteType_DUP);
+		if (bytes.back() == BytecodeType_INDEX_A)
+		{
+			bytes.back() = BytecodeType_INDEX_A_REF;
+
+			bytes.push_back(ByteType_DUP);
+			bytes.push_back(BytecodeType_DEREF);
+		}
+		else if (bytecode_t store_elem_byte = store_elem_type(bytes.back()); store_elem_byte != _ByteType_INVALID_)
+		{
+			store_byte = store_elem_byte;
+
+			bytecode_t index_byte = bytes.back();
+			bytes.back() = ByteType_DUP2;
+			bytes.push_back(index_byte);
+		}
 	}
 
 	night::container_concat(bytes, rhs->generate_codes());
@@ -656,7 +715,7 @@ bytecodes_t expr::BinaryOp::generate_codes() const
 	bytecode_t operator_byte = generate_operator_byte();
 	assert(operator_byte != _ByteType_INVALID_);
 
-	bytes.push_back(operator_byte);
+	bytes.push_back(operator_byte == ByteType_STORE_INPLACE ? store_byte : operator_byte);
 
 	switch (operator_type) {
 	case BinaryOpType::ADD_ASSIGN:
@@ -664,12 +723,79 @@ bytecodes_t expr::BinaryOp::generate_codes() const
 	case BinaryOpType::MULT_ASSIGN:
 	case BinaryOpType::DIV_ASSIGN:
 	case BinaryOpType::MOD_ASSIGN:
-		bytes.push_back(ByteType_STORE_INPLACE);
+		bytes.push_back(store_byte);
 	}
 
 	return bytes;
 }
 
+bool expr::BinaryOp::is_variable_assignment() const
+{
+	switch (operator_type) {
+	case BinaryOpType::ASSIGN:
+	case BinaryOpType::ADD_ASSIGN:
+	case BinaryOpType::SUB_ASSIGN:
+	case BinaryOpType::MULT_ASSIGN:
+	case BinaryOpType::DIV_ASSIGN:
+	case BinaryOpType::MOD_ASSIGN:
+		return (bool)std::dynamic_pointer_cast<Variable>(lhs);
+	default:
+		return false;
+	}
+}
+
+bytecodes_t expr::BinaryOp::generate_variable_assignment_codes() const
+{
+	assert(lhs && rhs);
+	assert(is_variable_assignment());
+
+	auto variable = std::dynamic_pointer_cast<Variable>(lhs);
+
+	bytecodes_t bytes;
+
+	if (operator_type == BinaryOpType::ASSIGN)
+	{
+		bytes = rhs->generate_codes();
+	}
+	else
+	{
+		bytes = lhs->generate_codes();
+		night::container_concat(bytes, rhs->generate_codes());
+
+		bytecode_t operator_byte = generate_operator_byte();
+		assert(operator_byte != _ByteType_INVALID_);
+
+		bytes.push_back(operator_byte);
+	}
+
+	night::container_concat(bytes, variable->generate_store_codes());
+
+	return bytes;
+}
+
+bytecodes_t expr::BinaryOp::generate_short_circuit_codes() const
+{
+	assert(operator_type == BinaryOpType::AND || operator_type == BinaryOpType::OR);
+
+	bytecodes_t if_true = rhs->generate_codes();
+	bytecodes_t if_false = night::const_to_bytes(InterpreterScope::add_const((int64_t)0));
+
+	if (operator_type == BinaryOpType::OR)
+	{
+		if_false = std::move(if_true);
+		if_true = night::const_to_bytes(InterpreterScope::add_const((int64_t)1));
+	}
+
+	bytecodes_t bytes = lhs->generate_codes();
+
+	night::container_concat(bytes, night::jump_to_bytes(BytecodeType_JUMP_IF_FALSE, (jump_offset_t)(if_true.size() + night::jump_size)));
+	night::container_concat(bytes, if_true);
+	night::container_concat(bytes, night::jump_to_bytes(BytecodeType_JUMP, (jump_offset_t)if_false.size()));
+	night::container_concat(bytes, if_false);
+
+	return bytes;
+}
+
 std::pair<std::shared_ptr<expr::Array>, std::shared_ptr<expr::Array>> expr::BinaryOp::is_string_concatenation() const
 {
 	/*
@@ -749,8 +875,6 @@ bytecode_t expr::BinaryOp::generate_operator_byte() const
 		{ BinaryOpType::GREATER_EQUALS,	{ ByteType_GE_I,				ByteType_GE_F, ByteType_GE_S } },
 		{ BinaryOpType::EQUALS,			{ ByteType_EQ_I,	  	 ByteType_EQ_F,		    ByteType_EQ_S		  } },
 		{ BinaryOpType::NOT_EQUALS,		{ ByteType_NE_I, 	 ByteType_NE_F,	    ByteType_NE_S	  } },
-		{ BinaryOpType::AND,			{ BytecodeType_AND,				 BytecodeType_AND,			    _ByteType_INVALID_			  } },
-		{ BinaryOpType::OR,				{ BytecodeType_OR,				 BytecodeType_OR,			    _ByteType_INVALID_			  } },
 		{ BinaryOpType::SUBSCRIPT,		{ _ByteType_INVALID_,			 _ByteType_INVALID_,			BytecodeType_INDEX_S		  } }
 	};
 
@@ -760,8 +884,8 @@ bytecode_t expr::BinaryOp::generate_operator_byte() const
 		return operator_bytes.at(operator_type).str_;
 
 	// Separate case for array subscripts.
-	if ((lhs_type->is_arr() || rhs_type->is_arr()) && operator_type == BinaryOpType::SUBSCRIPT)
-		return BytecodeType_INDEX_A;
+	if (rhs_type->is_arr() && operator_type == BinaryOpType::SUBSCRIPT)
+		return night::index_arr_type(*rhs_type);
 
 	// Note that this is not the same as,
 	//   lhs_type == Type::INT || rhs_type == Type::INT
@@ -1,5 +1,6 @@
 #include "parser/ast/statement.hpp"
 #include "parser/statement_scope.hpp"
+#include "parser/ast/expression_operator.hpp"
 
 #include "interpreter/interpreter_scope.hpp"
 
@@ -8,8 +9,10 @@
 #include "common/util.hpp"
 #include "common/error.hpp"
 #include "common/debug.hpp"
+#include "language.hpp"
 
 #include <limits>
+#include <algorithm>
 #include <iterator>
 #include <ranges>
 #include <vector>
@@ -34,6 +37,8 @@ void VariableInit::check(StatementScope& scope)
 	if (!id.has_value())
 		return;
 
+	is_global = scope.is_global();
+
 	if (expr)
 	{
 		expr_type = expr->type_check(scope);
@@ -62,12 +67,10 @@ bytecodes_t VariableInit::generate_codes() const
 	if (expr)
 		bytes = expr->generate_codes();
 	else
-		bytes = int_to_bytes<int64_t>(0);
-
-	bytecodes_t id_bytes = int_to_bytes(id.value());
-	night::container_concat(bytes, id_bytes);
+		bytes = night::const_to_bytes(InterpreterScope::add_const((int64_t)0));
 
-	bytes.push_back(ByteType_STORE);
+	night::container_concat(bytes, night::variable_to_bytes(
+		is_global ? BytecodeType_STORE_GLOBAL : BytecodeType_STORE_LOCAL, id.value()));
 
 	return bytes;
 }
@@ -105,6 +108,8 @@ void ArrayInitialization::check(StatementScope& scope)
 	if (!id.has_value())
 		return;
 
+	is_global = scope.is_global();
+
 	if (expr)
 	{
 		expr_type = expr->type_check(scope);
@@ -133,11 +138,22 @@ bool ArrayInitialization::optimize(StatementScope& scope)
 	}
 
 	if (expr)
+	{
 		expr = expr->optimize(scope);
+	}
+	else if (std::all_of(std::begin(arr_sizes), std::end(arr_sizes), [](auto const& arr_size) { return (bool)arr_size; }))
+	{
+		// Arrays with every size specified are allocated as a single block
+		expr = std::make_shared<expr::Allocate>(name_loc, type.get_prim(), arr_sizes);
+		return true;
+	}
 	else
+	{
 		expr = std::make_shared<expr::Array>(name_loc, std::vector<expr::expr_p>(), false);
+	}
 	
 	fill_array(type, expr, 0);
+	expr::set_arr_type(expr, type);
 
 	return true;
 }
@@ -149,10 +165,8 @@ bytecodes_t ArrayInitialization::generate_codes() const
 
 	bytecodes_t bytes = expr->generate_codes();
 
-	auto id_bytes = int_to_bytes(id.value());
-	night::container_concat(bytes, id_bytes);
-
-	bytes.push_back(ByteType_STORE);
+	night::container_concat(bytes, night::variable_to_bytes(
+		is_global ? BytecodeType_STORE_GLOBAL : BytecodeType_STORE_LOCAL, id.value()));
 
 	return bytes;
 }
@@ -251,7 +265,10 @@ bool Conditional::optimize(StatementScope& scope)
 bytecodes_t Conditional::generate_codes() const
 {
 	bytecodes_t codes;
-	std::vector<int> jump_offsets;
+
+	// Indices of the JUMPs at the end of each conditional body. Their offsets are
+	// set once the size of the whole conditional chain is known.
+	std::vector<std::size_t> jump_indices;
 
 	for (auto const& [cond_expr, stmts] : conditionals)
 	{
@@ -259,49 +276,36 @@ bytecodes_t Conditional::generate_codes() const
 		// and add a true constant
 		if (cond_expr)
 		{
-			auto cond_codes = cond_expr->generate_codes();
-			codes.insert(std::end(codes), std::begin(cond_codes), std::end(cond_codes));
+			night::container_concat(codes, cond_expr->generate_codes());
 		}
 		else
 		{
 			auto numeric_true = expr::Numeric(loc, Primitive::BOOL, 1);
-			auto cond_codes = numeric_true.generate_codes();
-			codes.insert(std::end(codes), std::begin(cond_codes), std::end(cond_codes));
+			night::container_concat(codes, numeric_true.generate_codes());
 		}
 
-		// The value for JUMP_IF_FALSE is added after we determine the number of codes
-		// to jump over
-		codes.push_back(BytecodeType_JUMP_IF_FALSE);
-
-		uint64_t jump_if_false_index = codes.size() - 1;
-
-		// Used to determine number of codes to jump over for JUMP_IF_FALSE
-		std::size_t stmts_codes_size = 0;
+		// The offset for JUMP_IF_FALSE is set after we determine the number of
+		// codes to jump over
+		std::size_t jump_if_false_index = codes.size();
+		night::container_concat(codes, night::jump_to_bytes(BytecodeType_JUMP_IF_FALSE));
 
 		for (auto const& stmt : stmts)
-		{
-			auto stmt_codes = stmt->generate_codes();
-			codes.insert(std::end(codes), std::begin(stmt_codes), std::end(stmt_codes));
+			night::container_concat(codes, stmt->generate_codes());
 
-			stmts_codes_size += stmt_codes.size();
-		}
-
-		// Insert jump if false value before JUMP_IF_FALSE, adding on 10 space for the
-		// 10 codes to represent JUMP (1) and its value (9)
-		auto jump_if_false_codes = int_to_bytes<uint64_t>(stmts_codes_size + 10);
-		night::container_insert(codes, jump_if_false_codes, jump_if_false_index);
+		// The offset for JUMP is set last after the size of the whole conditional
+		// chain is determined
+		jump_indices.push_back(codes.size());
+		night::container_concat(codes, night::jump_to_bytes(BytecodeType_JUMP));
 
-		// The value for JUMP is added last after the number of codes to jump back is
-		// determined
-		codes.push_back(BytecodeType_JUMP);
-		jump_offsets.push_back((int)codes.size() - 1);
+		// JUMP_IF_FALSE jumps to the first code after the JUMP, which is the next
+		// conditional in the chain
+		night::set_jump_offset(codes, jump_if_false_index,
+			(jump_offset_t)(codes.size() - jump_if_false_index - night::jump_size));
 	}
 
-	for (int i = (int)jump_offsets.size() - 1; i >= 0; --i)
-	{
-		auto offset_codes = int_to_bytes<uint64_t>(codes.size() - jump_offsets[i] - 1);
-		night::container_insert(codes, offset_codes, jump_offsets[i]);
-	}
+	for (std::size_t jump_index : jump_indices)
+		night::set_jump_offset(codes, jump_index,
+			(jump_offset_t)(codes.size() - jump_index - night::jump_size));
 
 	return codes;
 }
@@ -349,32 +353,21 @@ bytecodes_t While::generate_codes() const
 {
 	auto codes = cond_expr->generate_codes();
 
-	// The value for JUMP_IF_FALSE is added after we determine the number of codes
+	// The offset for JUMP_IF_FALSE is set after we determine the number of codes
 	// to jump over
-	codes.push_back(BytecodeType_JUMP_IF_FALSE);
-	auto jump_if_false_index = codes.size() - 1;
-
-	// Used to determine number of codes to jump over for JUMP_IF_FALSE
-	uint64_t stmt_codes_size = 0;
+	std::size_t jump_if_false_index = codes.size();
+	night::container_concat(codes, night::jump_to_bytes(BytecodeType_JUMP_IF_FALSE));
 
 	for (auto const& stmt : block)
-	{
-		auto stmt_codes = stmt->generate_codes();
-		codes.insert(std::end(codes), std::begin(stmt_codes), std::end(stmt_codes));
+		night::container_concat(codes, stmt->generate_codes());
 
-		stmt_codes_size += stmt_codes.size();
-	}
-
-	// Insert jump if false value before JUMP_IF_FALSE, adding on 10 space for the
-	// 10 codes to represent JUMP_N (1) and its value (9)
-	auto jump_if_false_codes = int_to_bytes(stmt_codes_size + 10);
-	night::container_insert(codes, jump_if_false_codes, jump_if_false_index);
+	// JUMP back to the first code of the condition
+	night::container_concat(codes, night::jump_to_bytes(
+		BytecodeType_JUMP, -(jump_offset_t)(codes.size() + night::jump_size)));
 
-	// Insert jump negative value and JUMP_N
-	// Set jump negative value to be 8 bit
-	auto jump_n_bytes = int_to_bytes<uint64_t>(codes.size() + 9);
-	codes.insert(std::end(codes), std::begin(jump_n_bytes), std::end(jump_n_bytes));
-	codes.push_back(ByteType_JUMP_N);
+	// JUMP_IF_FALSE jumps to the first code after the JUMP
+	night::set_jump_offset(codes, jump_if_false_index,
+		(jump_offset_t)(codes.size() - jump_if_false_index - night::jump_size));
 
 	return codes;
 }
@@ -406,11 +399,128 @@ bytecodes_t For::generate_codes() const
 	auto codes = var_init.generate_codes();
 
 	auto loop_codes = loop.generate_codes();
+	remove_bounds_checks(codes, loop_codes);
 	codes.insert(std::end(codes), std::begin(loop_codes), std::end(loop_codes));
 
 	return codes;
 }
 
+/*
+ * A bytecode type and its operand, read from the codes of a loop.
+ */
+struct LoopCode
+{
+	std::size_t index;
+	bytecode_t type;
+
+	// Variable id, constant or integer value.
+	uint64_t operand;
+};
+
+static std::vector<LoopCode> read_loop_codes(bytecodes_t const& codes)
+{
+	std::vector<LoopCode> loop_codes;
+
+	for (std::size_t i = 0; i < codes.size(); i += 1 + night::operand_size(codes[i]))
+	{
+		uint64_t operand = 0;
+		for (std::size_t j = night::operand_size(codes[i]); j > 0; --j)
+			operand = (operand << 8) | codes[i + j];
+
+		if (codes[i] == BytecodeType_LOAD_CONST)
+			operand = InterpreterScope::consts[operand].as.ui;
+
+		loop_codes.push_back({ i, codes[i], operand });
+	}
+
+	return loop_codes;
+}
+
+static bool is_load_of(LoopCode const& code, LoopCode const& store)
+{
+	return code.operand == store.operand &&
+		((code.type == BytecodeType_LOAD_LOCAL && store.type == BytecodeType_STORE_LOCAL) ||
+		 (code.type == BytecodeType_LOAD_GLOBAL && store.type == BytecodeType_STORE_GLOBAL));
+}
+
+static bool is_store_to(LoopCode const& code, LoopCode const& load)
+{
+	return code.operand == load.operand &&
+		((code.type == BytecodeType_STORE_LOCAL && load.type == BytecodeType_LOAD_LOCAL) ||
+		 (code.type == BytecodeType_STORE_GLOBAL && load.type == BytecodeType_LOAD_GLOBAL));
+}
+
+void For::remove_bounds_checks(bytecodes_t const& init_codes, bytecodes_t& loop_codes) const
+{
+	// The loop variable starts at a non-negative constant,
+	//   LOAD_CONST, STORE i
+	std::vector<LoopCode> init = read_loop_codes(init_codes);
+
+	if (init.size() != 2 || init[0].type != BytecodeType_LOAD_CONST || (int64_t)init[0].operand < 0)
+		return;
+
+	LoopCode const& var_store = init[1];
+
+	// The loop runs while the variable is less than the length of a string, or
+	// less than the length with a non-negative constant subtracted or divided,
+	//   LOAD i, LOAD s, uINT8 LEN, CALL, (LOAD_CONST, SUB_I or DIV_I)*, LT_I, JUMP_IF_FALSE
+	std::vector<LoopCode> loop = read_loop_codes(loop_codes);
+
+	if (loop.size() < 6 || !is_load_of(loop[0], var_store) ||
+		(loop[1].type != BytecodeType_LOAD_LOCAL && loop[1].type != BytecodeType_LOAD_GLOBAL) ||
+		loop[2].type != ByteType_uINT8 || loop[2].operand != PredefinedFunctions::LEN ||
+		loop[3].type != BytecodeType_CALL)
+		return;
+
+	LoopCode const& str_load = loop[1];
+	std::size_t i = 4;
+
+	for (; i + 1 < loop.size() && loop[i].type == BytecodeType_LOAD_CONST; i += 2)
+	{
+		if (!(loop[i + 1].type == ByteType_SUB_I && (int64_t)loop[i].operand >= 0) &&
+			!(loop[i + 1].type == ByteType_DIV_I && (int64_t)loop[i].operand >= 1))
+			return;
+	}
+
+	if (i + 1 >= loop.size() || loop[i].type != ByteType_LT_I || loop[i + 1].type != BytecodeType_JUMP_IF_FALSE)
+		return;
+
+	std::size_t block_begin = i + 2;
+	std::size_t block_end = loop.size() - 1;
+
+	// The block ends by adding a non-negative constant to the variable, which
+	// is the only store to the variable or the string,
+	//   LOAD i, LOAD_CONST, ADD_I, STORE i, JUMP
+	if (block_end < block_begin + 4 ||
+		!is_load_of(loop[block_end - 4], var_store) ||
+		loop[block_end - 3].type != BytecodeType_LOAD_CONST || (int64_t)loop[block_end - 3].operand < 0 ||
+		loop[block_end - 2].type != ByteType_ADD_I ||
+		loop[block_end - 1].type != var_store.type || loop[block_end - 1].operand != var_store.operand)
+		return;
+
+	// Functions can store to global variables
+	bool is_global = var_store.type == BytecodeType_STORE_GLOBAL || str_load.type == BytecodeType_LOAD_GLOBAL;
+
+	for (std::size_t j = block_begin; j < block_end - 1; ++j)
+	{
+		if (is_store_to(loop[j], str_load) ||
+			(loop[j].type == var_store.type && loop[j].operand == var_store.operand))
+			return;
+
+		if (is_global && loop[j].type == BytecodeType_CALL && loop[j - 1].operand >= PREDEFINED_FUNCTIONS_COUNT)
+			return;
+	}
+
+	// Every 's[i]' in the block is now in bounds
+	for (std::size_t j = block_begin + 2; j < block_end; ++j)
+	{
+		if (loop[j].type == BytecodeType_INDEX_S &&
+			is_load_of(loop[j - 2], var_store) &&
+			loop[j - 1].type == str_load.type && loop[j - 1].operand == str_load.operand)
+			loop_codes[loop[j].index] = BytecodeType_INDEX_S_UNCHECKED;
+	}
+}
+
 
 Parameter::Parameter(
 	std::string const& _name,
@@ -466,6 +576,8 @@ void Function::check(StatementScope& global_scope)
 
 	for (auto& statement : body)
 		statement->check(func_scope);
+
+	frame_size = func_scope.get_frame_size();
 }
 
 bool Function::optimize(StatementScope& scope)
@@ -483,14 +595,23 @@ bytecodes_t Function::generate_codes() const
 	for (auto const& param_id : parameter_ids)
 		InterpreterScope::funcs[id.value()].param_ids.push_back(param_id);
 
+	InterpreterScope::funcs[id.value()].frame_size = frame_size;
+	InterpreterScope::funcs[id.value()].returns_value = rtn_type.has_value();
+
+	bytecodes_t codes;
 	for (auto const& stmt : body)
 	{
 		auto stmt_codes = stmt->generate_codes();
-		InterpreterScope::funcs[id.value()].codes.insert(
-			std::end(InterpreterScope::funcs[id.value()].codes),
-			std::begin(stmt_codes), std::end(stmt_codes));
+		codes.insert(std::end(codes), std::begin(stmt_codes), std::end(stmt_codes));
 	}
 
+	// Functions without a return value can end without a return statement.
+	codes.push_back(BytecodeType_RETURN);
+
+	night::link_jumps(codes);
+	InterpreterScope::funcs[id.value()].instructions = intpr::decode(codes);
+	InterpreterScope::funcs[id.value()].max_stack_size = intpr::max_stack_size(InterpreterScope::funcs[id.value()].instructions);
+
 	return {};
 }
 
@@ -519,6 +640,8 @@ void Return::check(StatementScope& scope)
 			night::error::get().create_minor_error(
 				"Expected return type of " + night::to_str(scope.return_type.value()) + " to match the functions return type.\n"
 				"Found return type of " + night::to_str(expr_type.value()) + ".", loc);
+
+		expr::set_arr_type(expr, *scope.return_type);
 	}
 	else
 	{
@@ -537,6 +660,9 @@ bool Return::optimize(StatementScope& scope)
 
 bytecodes_t Return::generate_codes() const
 {
+	if (auto call = std::dynamic_pointer_cast<expr::FunctionCall>(expr))
+		return call->generate_tail_call_codes();
+
 	auto codes = expr->generate_codes();
 
 	codes.push_back(BytecodeType_RETURN);
@@ -562,7 +688,8 @@ void expr::ExpressionStatement::check(StatementScope& scope)
 
 std::optional<Type> expr::ExpressionStatement::type_check(StatementScope& scope) noexcept
 {
-	return expr->type_check(scope);
+	expr_type = expr->type_check(scope);
+	return expr_type;
 }
 
 bool expr::ExpressionStatement::optimize(StatementScope& scope)
@@ -578,5 +705,14 @@ expr::expr_p expr::ExpressionStatement::optimize(StatementScope const& scope)
 
 bytecodes_t expr::ExpressionStatement::generate_codes() const
 {
-	return expr->generate_codes();
+	if (auto binary_op = std::dynamic_pointer_cast<BinaryOp>(expr); binary_op && binary_op->is_variable_assignment())
+		return binary_op->generate_variable_assignment_codes();
+
+	auto codes = expr->generate_codes();
+
+	// Void function calls do not leave a value
+	if (expr_type.has_value())
+		codes.push_back(BytecodeType_POP);
+
+	return codes;
 }
@@ -1,5 +1,6 @@
 #include "parser/code_gen.hpp"
 #include "parser/ast/statement.hpp"
+#include "interpreter/interpreter_scope.hpp"
 #include "common/bytecode.hpp"
 
 bytecodes_t code_gen(std::vector<stmt_p>& block)
@@ -13,6 +14,8 @@ bytecodes_t code_gen(std::vector<stmt_p>& block)
 	if (night::error::get().has_minor_errors())
 		throw night::error::get();
 
+	InterpreterScope::global_frame_size = global_scope.get_frame_size();
+
 	for (auto i = 0; i < block.size(); ++i)
 	{
 		bool keep = block[i]->optimize(global_scope);
@@ -33,5 +36,7 @@ bytecodes_t code_gen(std::vector<stmt_p>& block)
 		codes.insert(std::end(codes), std::begin(ast_codes), std::end(ast_codes));
 	}
 
+	night::link_jumps(codes);
+
 	return codes;
 }
\ No newline at end of file
@@ -98,25 +98,33 @@ scope_func_container StatementScope::functions = {
 
 
 StatementScope::StatementScope()
-	: variables() {}
+	: variables()
+	, global(true)
+	, next_slot(0)
+	, frame_size(std::make_shared<night::id_t>(0)) {}
 
 StatementScope::StatementScope(
 	StatementScope const& parent_scope)
-	: variables(parent_scope.variables)
-	, return_type(parent_scope.return_type) {}
+	: return_type(parent_scope.return_type)
+	, variables(parent_scope.variables)
+	, global(parent_scope.global)
+	, next_slot(parent_scope.next_slot)
+	, frame_size(parent_scope.frame_size) {}
 
 StatementScope::StatementScope(
 	StatementScope const& parent_scope,
 	std::optional<Type> const& _return_type)
-	: variables(parent_scope.variables)
-	, return_type(_return_type) {}
+	: return_type(_return_type)
+	, variables(parent_scope.variables)
+	, global(false)
+	, next_slot(0)
+	, frame_size(std::make_shared<night::id_t>(0)) {}
 
 std::optional<night::id_t> StatementScope::create_variable(
 	std::string const& name,
 	Location	const& name_location,
 	Type const& type)
 {
-	static night::id_t variable_id = 0;
 	static night::id_t const max_variables = std::numeric_limits<night::id_t>::max();
 
 	if (variables.contains(name))
@@ -126,17 +134,21 @@ std::optional<night::id_t> StatementScope::create_variable(
 		return std::nullopt;
 	}
 
-	if (variable_id == max_variables)
+	if (next_slot == max_variables)
 	{
 		night::error::get().create_minor_error(
 			"Only " + std::to_string(max_variables) + " variables are allowed per scope.", name_location);
 		return std::nullopt;
 	}
 
-	variables[name] = { variable_id, type, 0 };
+	variables[name] = { next_slot, type, global, 0 };
 	variables[name].type.set_category(TypeCategory::Addressable);
 
-	return variable_id++;
+	++next_slot;
+	if (*frame_size < next_slot)
+		*frame_size = next_slot;
+
+	return next_slot - 1;
 }
 
 StatementVariable const* StatementScope::get_variable(
@@ -175,6 +187,16 @@ StatementVariable const* StatementScope::get_variable(
 	return &variable->second;
 }
 
+bool StatementScope::is_global() const
+{
+	return global;
+}
+
+night::id_t StatementScope::get_frame_size() const
+{
+	return *frame_size;
+}
+
 std::optional<night::id_t> StatementScope::create_function(
 	std::string const& name,
 	Location	const& name_location,
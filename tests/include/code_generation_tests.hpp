@@ -6,8 +6,10 @@
 #include "parser/statement_scope.hpp"
 #include "parser/code_gen.hpp"
 #include "interpreter/interpreter.hpp"
+#include "interpreter/interpreter_scope.hpp"
 #include "common/bytecode.hpp"
 #include "common/error.hpp"
+#include "common/util.hpp"
 
 
 std::string test_code_gen_expression_basic()
@@ -25,13 +27,14 @@ std::string test_code_gen_expression_basic()
 	(void)expr->optimize(scope); // Unnecessary for this unit test, but consistent with intended usage
 	bytecodes_t bytes = expr->generate_codes();
 
+	// Literals are loaded from the constant pool
+	bytecodes_t expected = night::const_to_bytes(InterpreterScope::add_const((int64_t)2));
+	night::container_concat(expected, night::const_to_bytes(InterpreterScope::add_const((int64_t)3)));
+	expected.push_back(ByteType_ADD_I);
+
 	int i = 0;
-	bytecode_t expected[] = {
-		ByteType_sINT8, 2, 0, 0, 0, 0, 0, 0, 0,
-		ByteType_sINT8, 3, 0, 0, 0, 0, 0, 0, 0,
-		ByteType_ADD_I };
 
-	night_assert_eq(bytes.size(), sizeof(expected) / sizeof(expected[0]));
+	night_assert_eq(bytes.size(), expected.size());
 
 	for (auto const& byte : bytes)
 		night_assert_eq(byte, expected[i++]);
@@ -49,17 +52,210 @@ std::string test_code_gen_variable_init()
 
 	bytecodes_t bytes = code_gen(statements);
 
+	bytecodes_t expected = night::const_to_bytes(InterpreterScope::add_const((int64_t)5));
+	night::container_concat(expected, night::variable_to_bytes(BytecodeType_STORE_GLOBAL, 0));
+
 	int i = 0;
-	bytecode_t expected[] = {
-		ByteType_sINT8, 5, 0, 0, 0, 0, 0, 0, 0,
-		ByteType_uINT8, 0, 0, 0, 0, 0, 0, 0, 0,
-		ByteType_STORE
-	};
 
-	night_assert_eq(bytes.size(), sizeof(expected) / sizeof(expected[0]));
+	night_assert_eq(bytes.size(), expected.size());
 
 	for (auto const& byte : bytes)
 		night_assert_eq(byte, expected[i++]);
 
 	return "";
-}
\ No newline at end of file
+}
+
+std::string test_code_gen_decode()
+{
+	std::string file_name = create_test_file(
+		"my_var int32 = 2 + 3;"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	night_assert_eq(instructions.size(), 2);
+
+	night_assert_eq(instructions[0].type, BytecodeType_LOAD_CONST);
+	night_assert_eq(instructions[0].operand.i, 5);
+
+	night_assert_eq(instructions[1].type, BytecodeType_STORE_GLOBAL);
+	night_assert_eq(instructions[1].operand.ui, bytes[6]);
+
+	return "";
+}
+
+std::string test_code_gen_variable_slots()
+{
+	StatementScope global_scope;
+	night_assert_eq(global_scope.create_variable("a", Location(), Primitive::INT32).value(), 0);
+
+	{
+		StatementScope block_scope(global_scope);
+		night_assert_eq(block_scope.create_variable("b", Location(), Primitive::INT32).value(), 1);
+		night_assert_eq(block_scope.create_variable("c", Location(), Primitive::INT32).value(), 2);
+	}
+
+	// Slots of a block scope are reused once it ends
+	night_assert_eq(global_scope.create_variable("d", Location(), Primitive::INT32).value(), 1);
+	night_assert_eq(global_scope.get_frame_size(), 3);
+
+	// Functions have their own frame
+	StatementScope func_scope(global_scope, std::nullopt);
+	night_assert_eq(func_scope.create_variable("e", Location(), Primitive::INT32).value(), 0);
+	night_assert_eq(func_scope.get_frame_size(), 1);
+
+	return "";
+}
+
+std::string test_code_gen_max_stack_size()
+{
+	std::string file_name = create_test_file(
+		"x int32 = 1;"
+		"y int32 = x + x * x;"
+		"if (y > 2) { y = x; }"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	night_assert_eq(intpr::max_stack_size(instructions), 3);
+
+	return "";
+}
+
+std::string test_code_gen_tail_call()
+{
+	std::string file_name = create_test_file(
+		"def tail_count(n int32, acc int32) int32"
+		"{"
+		"	if (n == 0) { return acc; }"
+		"	return tail_count(n - 1, acc + 1);"
+		"}"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+	code_gen(statements);
+
+	auto func = StatementScope::functions.find("tail_count");
+	night_assert_tr(func != std::end(StatementScope::functions));
+
+	intpr::instructions_t const& instructions = InterpreterScope::funcs[func->second.id].instructions;
+
+	// The recursive call reuses the frame, and returns the value directly
+	night_assert_eq(instructions[instructions.size() - 2].type, BytecodeType_TAIL_CALL);
+	night_assert_eq(instructions[instructions.size() - 2].operand.ui, func->second.id);
+	night_assert_eq(instructions.back().type, BytecodeType_RETURN);
+
+	return "";
+}
+
+std::string test_code_gen_str_literal()
+{
+	std::string file_name = create_test_file(
+		"a char[] = \"night\";"
+		"b char[] = \"night\";"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	night_assert_eq(instructions.size(), 4);
+
+	// Equal literals are the same interned string
+	night_assert_eq(instructions[0].type, BytecodeType_LOAD_CONST);
+	night_assert_eq(instructions[2].type, BytecodeType_LOAD_CONST);
+	night_assert_eq(instructions[0].operand.ui, instructions[2].operand.ui);
+
+	night_assert_eq(std::string((char*)instructions[0].operand.ui), "night");
+
+	return "";
+}
+
+std::string test_code_gen_unboxed_arr()
+{
+	std::string file_name = create_test_file(
+		"a int16[] = [1, 2];"
+		"a[1] = a[0];"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	// The literal takes the size of the elements of the variable
+	night_assert_eq(instructions[2].type, ByteType_uINT8);
+	night_assert_eq(instructions[2].operand.ui, sizeof(int16_t));
+	night_assert_eq(instructions[3].type, BytecodeType_ALLOCATE_ARR);
+	night_assert_eq(instructions[3].operand.ui, 2);
+
+	night_assert_eq(instructions[9].type, BytecodeType_INDEX_A_I16);
+	night_assert_eq(instructions[10].type, BytecodeType_STORE_INDEX_A_16);
+
+	return "";
+}
+
+std::string test_code_gen_bounds_checks()
+{
+	std::string file_name = create_test_file(
+		"s char[] = \"night\";"
+		"for (i int32 = 0; i < len(s); i += 1) { print(s[i]); }"
+		"for (i int32 = 0; i < len(s); i += 1) { print(s[i + 1]); }"
+		"for (i int32 = 0; i < len(s); i += 1) { print(s[i]); s += \"!\"; }"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	int checked = 0;
+	int unchecked = 0;
+
+	for (auto const& instruction : instructions)
+	{
+		checked += instruction.type == BytecodeType_INDEX_S;
+		unchecked += instruction.type == BytecodeType_INDEX_S_UNCHECKED;
+	}
+
+	// Only the first loop is known to index inside the string
+	night_assert_eq(unchecked, 1);
+	night_assert_eq(checked, 2);
+
+	return "";
+}
+
+std::string test_code_gen_superinstructions()
+{
+	std::string file_name = create_test_file(
+		"x int32 = 0;"
+		"while (x < 10) { x -= 2; }"
+	);
+
+	std::vector<stmt_p> statements = parse_file(file_name);
+
+	bytecodes_t bytes = code_gen(statements);
+	intpr::instructions_t instructions = intpr::decode(bytes);
+
+	night_assert_eq(instructions.size(), 7);
+
+	night_assert_eq(instructions[4].type, BytecodeType_LT_I_JUMP_IF_FALSE);
+	night_assert_eq(instructions[4].operand.ui, 7);
+
+	night_assert_eq(instructions[5].type, BytecodeType_INC_GLOBAL);
+	night_assert_eq(instructions[5].id, instructions[1].operand.ui);
+	night_assert_eq(instructions[5].operand.i, -2);
+
+	// The loop jumps back to its condition, which is not fused
+	night_assert_eq(instructions[6].type, BytecodeType_JUMP);
+	night_assert_eq(instructions[6].operand.ui, 2);
+
+	return "";
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ntest.hpp"
+#include "interpreter/heap.hpp"
+#include "interpreter/interpreter_scope.hpp"
+
+#include <string>
+#include <string.h>
+
+std::string test_heap_collect()
+{
+	InterpreterScope::global_frame_size = 1;
+
+	InterpreterScope scope;
+	InterpreterScope::global_scope = &scope;
+
+	intpr::Heap::collect(nullptr, nullptr);
+	std::size_t empty_size = intpr::Heap::size();
+
+	intpr::Value stack[2];
+
+	// A string only reachable from an array, and an array only reachable
+	// through a reference to its element
+	intpr::Array* arr = intpr::Heap::allocate_arr(2);
+	arr->data[1] = intpr::Heap::allocate_str(3);
+	stack[0] = intpr::Value(&arr->data[1]);
+
+	// Garbage
+	stack[1] = intpr::Heap::allocate_str(5);
+	intpr::Heap::allocate_arr(4);
+
+	std::size_t live_size = sizeof(intpr::Array) + 2 * sizeof(intpr::Value) + sizeof(intpr::String) + intpr::Heap::small_str_length + 1;
+
+	intpr::Heap::collect(stack, stack + 1);
+	night_assert_eq(intpr::Heap::size(), empty_size + live_size);
+
+	scope.set_variable(0, stack[0]);
+	intpr::Heap::collect(nullptr, nullptr);
+	night_assert_eq(intpr::Heap::size(), empty_size + live_size);
+
+	scope.set_variable(0, intpr::Value((int64_t)0));
+	intpr::Heap::collect(nullptr, nullptr);
+	night_assert_eq(intpr::Heap::size(), empty_size);
+
+	InterpreterScope::global_scope = nullptr;
+
+	return "";
+}
+
+std::string test_heap_concat()
+{
+	char* half = intpr::Heap::allocate_str(40);
+	memset(half, 'a', 40);
+
+	char* s = intpr::Heap::concat(half, half);
+	night_assert_eq(intpr::str_len(s), 80);
+	night_assert_eq(intpr::str_data(s), std::string(80, 'a'));
+
+	// Short concatenations are copied directly
+	char* c = intpr::Heap::allocate_str(1);
+	c[0] = 'b';
+	night_assert_eq(intpr::Heap::concat(c, c), std::string("bb"));
+
+	return "";
+}
+
+std::string test_heap_allocate_arr()
+{
+	intpr::Array* arr = intpr::Heap::allocate_arr({ 2, 3 });
+	night_assert_eq(arr->size, 2);
+
+	intpr::Array* row0 = arr->data[0].as.a;
+	intpr::Array* row1 = arr->data[1].as.a;
+	night_assert_eq(row0->size, 3);
+	night_assert_eq(row1->size, 3);
+	night_assert_eq(row1->data[2].as.i, 0);
+
+	// Elements are stored after each other in row-major order
+	night_assert_tr(row1->data == row0->data + 3);
+
+	return "";
+}
@@ -13,6 +13,7 @@
 #include <sstream>
 #include <string>
 #include <cstdio>
+#include <cinttypes>
 #include <fstream>
 
 std::string test_predefined_function_conversions()
@@ -36,13 +37,12 @@ std::string test_predefined_function_conversions()
 	auto statements = parse_file(file_name);
 	auto bytecodes = code_gen(statements);
 
-	char out[64];
-	out[0] = '\0';
+	intpr::MemorySink out;
 
 	InterpreterScope scope;
-	interpret_bytecodes(scope, bytecodes, true, out);
+	interpret_bytecodes(scope, intpr::decode(bytecodes), true, &out);
 
-	night_assert_eq(std::string(out),
+	night_assert_eq(out.str(),
 		"a"
 		"9"
 		"1"
@@ -59,4 +59,110 @@ std::string test_predefined_function_conversions()
 	);
 
 	return "";
-}
\ No newline at end of file
+}
+
+std::string test_predefined_function_print_sinks()
+{
+	// Larger than the Interpreter's output buffer
+	std::string file_name = create_test_file(
+		"for (i int32 = 0; i < 20000; i += 1) { print(\"night\"); print(i % 10); }"
+	);
+
+	auto statements = parse_file(file_name);
+	auto instructions = intpr::decode(code_gen(statements));
+
+	std::string expected;
+	for (int i = 0; i < 20000; ++i)
+		expected += "night" + std::to_string(i % 10);
+
+	intpr::MemorySink memory;
+
+	InterpreterScope memory_scope;
+	interpret_bytecodes(memory_scope, instructions, true, &memory);
+
+	night_assert_eq(memory.str(), expected);
+
+	std::string chunks;
+	intpr::CallbackSink callback([&](char const* data, std::size_t length) {
+		chunks.append(data, length);
+	});
+
+	InterpreterScope callback_scope;
+	interpret_bytecodes(callback_scope, instructions, true, &callback);
+
+	night_assert_eq(chunks, expected);
+
+	return "";
+}
+
+std::string test_predefined_function_print_numbers()
+{
+	std::string file_name = create_test_file(
+		"big int64 = 1000000000;"
+		"neg int64 = -7;"
+		"print(0); print(\" \"); print(neg); print(\" \"); print(99); print(\" \"); print(100); print(\" \");"
+		"print(big * big * 9); print(\" \"); print(neg * big * big); print(\" \");"
+		"print(1.0 / 3.0); print(\" \"); print(0.00001); print(\" \"); print(100.0); print(\" \");"
+		"print(str(-2.5));"
+	);
+
+	auto statements = parse_file(file_name);
+	auto bytecodes = code_gen(statements);
+
+	intpr::MemorySink out;
+
+	InterpreterScope scope;
+	interpret_bytecodes(scope, intpr::decode(bytecodes), true, &out);
+
+	// Numbers are printed exactly like their printf() formats
+	char expected[256];
+	snprintf(expected, sizeof(expected),
+		"%" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 " %.17gf %.17gf %.17gf %f",
+		(int64_t)0, (int64_t)-7, (int64_t)99, (int64_t)100, (int64_t)9000000000000000000, (int64_t)-7000000000000000000,
+		1.0 / 3.0, 0.00001, 100.0, -2.5f);
+
+	night_assert_eq(out.str(), std::string(expected));
+
+	return "";
+}
+
+std::string test_predefined_function_str_to_num()
+{
+	auto interpret = [](std::string const& code, intpr::OutputSink* out = NULL) {
+		auto statements = parse_file(create_test_file(code));
+		auto bytecodes = code_gen(statements);
+
+		InterpreterScope scope;
+		interpret_bytecodes(scope, intpr::decode(bytecodes), true, out);
+	};
+
+	intpr::MemorySink out;
+	interpret(
+		"print(uint8(\"255\")); print(\" \");"
+		"print(int8(\"-128\")); print(\" \");"
+		"print(int32(\"+7\")); print(\" \");"
+		"print(uint64(\"18446744073709551615\")); print(\" \");"
+		"print(float(\"-0.5\"));",
+		&out
+	);
+
+	night_assert_eq(out.str(), "255 -128 7 18446744073709551615 -0.5f");
+
+	// Numbers that do not fit in their type, and strings that are not numbers
+	for (char const* code : {
+		"print(uint8(\"256\"));",
+		"print(int16(\"40000\"));",
+		"print(uint32(\"-1\"));",
+		"print(int64(\"12abc\"));",
+		"x char[] = \"\"; print(int32(x));",
+		"print(float(\"1e39\"));" })
+	{
+		try {
+			interpret(code);
+			night_assert_tr(false);
+		}
+		catch (night::error const&) { }
+	}
+
+	return "";
+}
@@ -2,6 +2,7 @@
 #include "expression_parser_units.hpp"
 #include "code_generation_tests.hpp"
 #include "predefined_functions.hpp"
+#include "heap_tests.hpp"
 
 #include <iostream>
 
@@ -20,8 +21,23 @@ int main()
 
 	night_test(test_code_gen_expression_basic);
 	night_test(test_code_gen_variable_init);
+	night_test(test_code_gen_decode);
+	night_test(test_code_gen_variable_slots);
+	night_test(test_code_gen_max_stack_size);
+	night_test(test_code_gen_tail_call);
+	night_test(test_code_gen_str_literal);
+	night_test(test_code_gen_unboxed_arr);
+	night_test(test_code_gen_bounds_checks);
+	night_test(test_code_gen_superinstructions);
 
 	night_test(test_predefined_function_conversions);
+	night_test(test_predefined_function_print_sinks);
+	night_test(test_predefined_function_print_numbers);
+	night_test(test_predefined_function_str_to_num);
+
+	night_test(test_heap_collect);
+	night_test(test_heap_concat);
+	night_test(test_heap_allocate_arr);
 
 	ntest::clean_test_files();
 